@@ -7,7 +7,7 @@
 using namespace Rcpp;
 
 // adapt_dyn_cpp
-arma::mat adapt_dyn_cpp(const uint32_t& n_reps, const std::vector<arma::vec>& V0, const std::vector<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const double& max_t, const double& min_N, const double& mut_sd, const double& mut_prob, const bool& show_progress, const uint32_t& max_clones, const uint32_t& save_every, const uint32_t& n_threads);
+List adapt_dyn_cpp(const uint32_t& n_reps, const std::vector<arma::vec>& V0, const std::vector<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const double& max_t, const double& min_N, const double& mut_sd, const double& mut_prob, const bool& show_progress, const uint32_t& max_clones, const uint32_t& save_every, const uint32_t& n_threads);
 RcppExport SEXP _sauron_adapt_dyn_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP max_tSEXP, SEXP min_NSEXP, SEXP mut_sdSEXP, SEXP mut_probSEXP, SEXP show_progressSEXP, SEXP max_clonesSEXP, SEXP save_everySEXP, SEXP n_threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -35,6 +35,36 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// hash_raw_cpp
+std::string hash_raw_cpp(const RawVector& x);
+RcppExport SEXP _sauron_hash_raw_cpp(SEXP xSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const RawVector& >::type x(xSEXP);
+    rcpp_result_gen = Rcpp::wrap(hash_raw_cpp(x));
+    return rcpp_result_gen;
+END_RCPP
+}
+// invasion_fitness_cpp
+List invasion_fitness_cpp(const arma::mat& V, const std::vector<double>& N, const arma::mat& V_inv, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const uint32_t& n_threads);
+RcppExport SEXP _sauron_invasion_fitness_cpp(SEXP VSEXP, SEXP NSEXP, SEXP V_invSEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type V(VSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type N(NSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type V_inv(V_invSEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(invasion_fitness_cpp(V, N, V_inv, f, a0, C, r0, D, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sel_str_cpp
 arma::mat sel_str_cpp(const arma::mat& V, const std::vector<double>& N, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D);
 RcppExport SEXP _sauron_sel_str_cpp(SEXP VSEXP, SEXP NSEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP) {
@@ -234,8 +264,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // quant_gen_cpp
-arma::mat quant_gen_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<arma::vec>& Vp0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const bool& show_progress, const uint32_t& n_threads);
-RcppExport SEXP _sauron_quant_gen_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP Vp0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
+List quant_gen_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<arma::vec>& Vp0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const arma::mat& raw_seeds, const double& max_secs, const bool& stop_gracefully, const bool& show_progress, const uint32_t& n_threads);
+RcppExport SEXP _sauron_quant_gen_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP Vp0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP raw_seedsSEXP, SEXP max_secsSEXP, SEXP stop_gracefullySEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -256,9 +286,422 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
     Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
     Rcpp::traits::input_parameter< const uint32_t& >::type save_every(save_everySEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type raw_seeds(raw_seedsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type max_secs(max_secsSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type stop_gracefully(stop_gracefullySEXP);
     Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
     Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
-    rcpp_result_gen = Rcpp::wrap(quant_gen_cpp(n_reps, V0, Vp0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, save_every, show_progress, n_threads));
+    rcpp_result_gen = Rcpp::wrap(quant_gen_cpp(n_reps, V0, Vp0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, save_every, raw_seeds, max_secs, stop_gracefully, show_progress, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// long_output_cpp
+List long_output_cpp(const arma::mat& wide, const std::vector<std::string>& id_names, const std::vector<int>& id_levels, const uint32_t& q, const bool& pheno);
+RcppExport SEXP _sauron_long_output_cpp(SEXP wideSEXP, SEXP id_namesSEXP, SEXP id_levelsSEXP, SEXP qSEXP, SEXP phenoSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type wide(wideSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::string>& >::type id_names(id_namesSEXP);
+    Rcpp::traits::input_parameter< const std::vector<int>& >::type id_levels(id_levelsSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type q(qSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type pheno(phenoSEXP);
+    rcpp_result_gen = Rcpp::wrap(long_output_cpp(wide, id_names, id_levels, q, pheno));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_basins_cpp
+List quant_gen_basins_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const std::vector<arma::mat>& attr_V, const std::vector<std::vector<double>>& attr_N, const std::vector<std::vector<uint32_t>>& attr_spp, const double& tol_V, const double& tol_N, const double& conv_tol, const uint32_t& check_every, const bool& show_progress, const uint32_t& n_threads);
+RcppExport SEXP _sauron_quant_gen_basins_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP attr_VSEXP, SEXP attr_NSEXP, SEXP attr_sppSEXP, SEXP tol_VSEXP, SEXP tol_NSEXP, SEXP conv_tolSEXP, SEXP check_everySEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<arma::mat>& >::type attr_V(attr_VSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<double>>& >::type attr_N(attr_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<uint32_t>>& >::type attr_spp(attr_sppSEXP);
+    Rcpp::traits::input_parameter< const double& >::type tol_V(tol_VSEXP);
+    Rcpp::traits::input_parameter< const double& >::type tol_N(tol_NSEXP);
+    Rcpp::traits::input_parameter< const double& >::type conv_tol(conv_tolSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type check_every(check_everySEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_basins_cpp(n_reps, V0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, attr_V, attr_N, attr_spp, tol_V, tol_N, conv_tol, check_every, show_progress, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_continuation_cpp
+List quant_gen_continuation_cpp(const arma::mat& V0, const arma::vec& N0, const double& p0, const double& f, const double& a0, const double& r0, const arma::mat& C0, const arma::mat& dC, const arma::mat& D0, const arma::mat& dD, const arma::vec& add_var, const double& direction, double ds, const double& ds_min, const double& ds_max, const uint32_t& max_steps, const std::vector<double>& p_range, const double& tol, const uint32_t& max_iter);
+RcppExport SEXP _sauron_quant_gen_continuation_cpp(SEXP V0SEXP, SEXP N0SEXP, SEXP p0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP r0SEXP, SEXP C0SEXP, SEXP dCSEXP, SEXP D0SEXP, SEXP dDSEXP, SEXP add_varSEXP, SEXP directionSEXP, SEXP dsSEXP, SEXP ds_minSEXP, SEXP ds_maxSEXP, SEXP max_stepsSEXP, SEXP p_rangeSEXP, SEXP tolSEXP, SEXP max_iterSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const arma::mat& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type p0(p0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C0(C0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type dC(dCSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D0(D0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type dD(dDSEXP);
+    Rcpp::traits::input_parameter< const arma::vec& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const double& >::type direction(directionSEXP);
+    Rcpp::traits::input_parameter< double >::type ds(dsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type ds_min(ds_minSEXP);
+    Rcpp::traits::input_parameter< const double& >::type ds_max(ds_maxSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type max_steps(max_stepsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type p_range(p_rangeSEXP);
+    Rcpp::traits::input_parameter< const double& >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type max_iter(max_iterSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_continuation_cpp(V0, N0, p0, f, a0, r0, C0, dC, D0, dD, add_var, direction, ds, ds_min, ds_max, max_steps, p_range, tol, max_iter));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_fork_cpp
+arma::mat quant_gen_fork_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<double>& N0, const std::deque<double>& add_var, const std::vector<arma::vec>& V_inv, const double& N_inv, const double& add_var_inv, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& fork_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const bool& show_progress, const uint32_t& n_threads);
+RcppExport SEXP _sauron_quant_gen_fork_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP add_varSEXP, SEXP V_invSEXP, SEXP N_invSEXP, SEXP add_var_invSEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP fork_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const std::vector<arma::vec>& >::type V_inv(V_invSEXP);
+    Rcpp::traits::input_parameter< const double& >::type N_inv(N_invSEXP);
+    Rcpp::traits::input_parameter< const double& >::type add_var_inv(add_var_invSEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type fork_t(fork_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type save_every(save_everySEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_fork_cpp(n_reps, V0, N0, add_var, V_inv, N_inv, add_var_inv, f, a0, C, r0, D, sigma_V0, sigma_N, sigma_V, fork_t, final_t, min_N, save_every, show_progress, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// qg_job_start_cpp
+SEXP qg_job_start_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<arma::vec>& Vp0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const uint32_t& n_threads);
+RcppExport SEXP _sauron_qg_job_start_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP Vp0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type Vp0(Vp0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type save_every(save_everySEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(qg_job_start_cpp(n_reps, V0, Vp0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, save_every, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// qg_job_status_cpp
+List qg_job_status_cpp(SEXP job_ptr);
+RcppExport SEXP _sauron_qg_job_status_cpp(SEXP job_ptrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job_ptr(job_ptrSEXP);
+    rcpp_result_gen = Rcpp::wrap(qg_job_status_cpp(job_ptr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// qg_job_results_cpp
+List qg_job_results_cpp(SEXP job_ptr);
+RcppExport SEXP _sauron_qg_job_results_cpp(SEXP job_ptrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job_ptr(job_ptrSEXP);
+    rcpp_result_gen = Rcpp::wrap(qg_job_results_cpp(job_ptr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// qg_job_cancel_cpp
+void qg_job_cancel_cpp(SEXP job_ptr, const bool& wait);
+RcppExport SEXP _sauron_qg_job_cancel_cpp(SEXP job_ptrSEXP, SEXP waitSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job_ptr(job_ptrSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type wait(waitSEXP);
+    qg_job_cancel_cpp(job_ptr, wait);
+    return R_NilValue;
+END_RCPP
+}
+// quant_gen_lyap_cpp
+List quant_gen_lyap_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const uint32_t& n_lyap, const bool& show_progress, const uint32_t& n_threads);
+RcppExport SEXP _sauron_quant_gen_lyap_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP n_lyapSEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type save_every(save_everySEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_lyap(n_lyapSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_lyap_cpp(n_reps, V0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, save_every, n_lyap, show_progress, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_sens_cpp
+List quant_gen_sens_cpp(const std::deque<arma::vec>& V0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const arma::mat& dC, const arma::mat& dD, const std::deque<double>& add_var, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const bool& show_progress);
+RcppExport SEXP _sauron_quant_gen_sens_cpp(SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP dCSEXP, SEXP dDSEXP, SEXP add_varSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP show_progressSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type dC(dCSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type dD(dDSEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type save_every(save_everySEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_sens_cpp(V0, N0, f, a0, C, r0, D, dC, dD, add_var, spp_gap_t, final_t, min_N, save_every, show_progress));
+    return rcpp_result_gen;
+END_RCPP
+}
+// qg_session_cpp
+SEXP qg_session_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const double& min_N, const uint32_t& n_threads);
+RcppExport SEXP _sauron_qg_session_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP min_NSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(qg_session_cpp(n_reps, V0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, min_N, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// qg_session_step_cpp
+void qg_session_step_cpp(SEXP session_ptr, const uint32_t& k, const bool& show_progress);
+RcppExport SEXP _sauron_qg_session_step_cpp(SEXP session_ptrSEXP, SEXP kSEXP, SEXP show_progressSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session_ptr(session_ptrSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type k(kSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    qg_session_step_cpp(session_ptr, k, show_progress);
+    return R_NilValue;
+END_RCPP
+}
+// qg_session_add_species_cpp
+void qg_session_add_species_cpp(SEXP session_ptr, const arma::mat& V, const std::vector<double>& N, const std::vector<double>& add_var);
+RcppExport SEXP _sauron_qg_session_add_species_cpp(SEXP session_ptrSEXP, SEXP VSEXP, SEXP NSEXP, SEXP add_varSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session_ptr(session_ptrSEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type V(VSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type N(NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type add_var(add_varSEXP);
+    qg_session_add_species_cpp(session_ptr, V, N, add_var);
+    return R_NilValue;
+END_RCPP
+}
+// qg_session_snapshot_cpp
+SEXP qg_session_snapshot_cpp(SEXP session_ptr);
+RcppExport SEXP _sauron_qg_session_snapshot_cpp(SEXP session_ptrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session_ptr(session_ptrSEXP);
+    rcpp_result_gen = Rcpp::wrap(qg_session_snapshot_cpp(session_ptr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// qg_session_extract_cpp
+List qg_session_extract_cpp(SEXP session_ptr);
+RcppExport SEXP _sauron_qg_session_extract_cpp(SEXP session_ptrSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session_ptr(session_ptrSEXP);
+    rcpp_result_gen = Rcpp::wrap(qg_session_extract_cpp(session_ptr));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_stream_cpp
+double quant_gen_stream_cpp(const std::string& file, const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const bool& show_progress, const uint32_t& n_threads, const bool& float32);
+RcppExport SEXP _sauron_quant_gen_stream_cpp(SEXP fileSEXP, SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP, SEXP float32SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type save_every(save_everySEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type float32(float32SEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_stream_cpp(file, n_reps, V0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, save_every, show_progress, n_threads, float32));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_summary_cpp
+arma::mat quant_gen_summary_cpp(const uint32_t& n_reps, const std::deque<arma::vec>& V0, const std::deque<double>& N0, const double& f, const double& a0, const arma::mat& C, const double& r0, const arma::mat& D, const std::deque<double>& add_var, const double& sigma_V0, const double& sigma_N, const std::vector<double>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& window, const bool& show_progress, const uint32_t& n_threads);
+RcppExport SEXP _sauron_quant_gen_summary_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP windowSEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const double& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const double& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const arma::mat& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const double& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type window(windowSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_summary_cpp(n_reps, V0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, window, show_progress, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_sweep_cpp
+List quant_gen_sweep_cpp(const std::vector<uint32_t>& n_reps, const std::vector<arma::mat>& V0, const std::vector<std::vector<double>>& N0, const std::vector<double>& f, const std::vector<double>& a0, const std::vector<arma::mat>& C, const std::vector<double>& r0, const std::vector<arma::mat>& D, const std::vector<std::vector<double>>& add_var, const std::vector<double>& sigma_V0, const std::vector<double>& sigma_N, const std::vector<std::vector<double>>& sigma_V, const uint32_t& spp_gap_t, const uint32_t& final_t, const double& min_N, const uint32_t& save_every, const bool& common_noise, const bool& antithetic, const bool& show_progress, const uint32_t& n_threads);
+RcppExport SEXP _sauron_quant_gen_sweep_cpp(SEXP n_repsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP fSEXP, SEXP a0SEXP, SEXP CSEXP, SEXP r0SEXP, SEXP DSEXP, SEXP add_varSEXP, SEXP sigma_V0SEXP, SEXP sigma_NSEXP, SEXP sigma_VSEXP, SEXP spp_gap_tSEXP, SEXP final_tSEXP, SEXP min_NSEXP, SEXP save_everySEXP, SEXP common_noiseSEXP, SEXP antitheticSEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<uint32_t>& >::type n_reps(n_repsSEXP);
+    Rcpp::traits::input_parameter< const std::vector<arma::mat>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<double>>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const std::vector<arma::mat>& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const std::vector<arma::mat>& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<double>>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_V0(sigma_V0SEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type sigma_N(sigma_NSEXP);
+    Rcpp::traits::input_parameter< const std::vector<std::vector<double>>& >::type sigma_V(sigma_VSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type final_t(final_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type save_every(save_everySEXP);
+    Rcpp::traits::input_parameter< const bool& >::type common_noise(common_noiseSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type antithetic(antitheticSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_sweep_cpp(n_reps, V0, N0, f, a0, C, r0, D, add_var, sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t, min_N, save_every, common_noise, antithetic, show_progress, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// quant_gen_warm_cpp
+List quant_gen_warm_cpp(const std::vector<uint32_t>& walk, const uint32_t& n_chains, const std::deque<arma::vec>& V0, const std::deque<double>& N0, const std::deque<double>& add_var, const std::vector<arma::mat>& C, const std::vector<arma::mat>& D, const std::vector<double>& f, const std::vector<double>& a0, const std::vector<double>& r0, const uint32_t& spp_gap_t, const uint32_t& max_t, const double& min_N, const uint32_t& check_every, const double& conv_tol, const bool& show_progress, const uint32_t& n_threads);
+RcppExport SEXP _sauron_quant_gen_warm_cpp(SEXP walkSEXP, SEXP n_chainsSEXP, SEXP V0SEXP, SEXP N0SEXP, SEXP add_varSEXP, SEXP CSEXP, SEXP DSEXP, SEXP fSEXP, SEXP a0SEXP, SEXP r0SEXP, SEXP spp_gap_tSEXP, SEXP max_tSEXP, SEXP min_NSEXP, SEXP check_everySEXP, SEXP conv_tolSEXP, SEXP show_progressSEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::vector<uint32_t>& >::type walk(walkSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_chains(n_chainsSEXP);
+    Rcpp::traits::input_parameter< const std::deque<arma::vec>& >::type V0(V0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type N0(N0SEXP);
+    Rcpp::traits::input_parameter< const std::deque<double>& >::type add_var(add_varSEXP);
+    Rcpp::traits::input_parameter< const std::vector<arma::mat>& >::type C(CSEXP);
+    Rcpp::traits::input_parameter< const std::vector<arma::mat>& >::type D(DSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type f(fSEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type a0(a0SEXP);
+    Rcpp::traits::input_parameter< const std::vector<double>& >::type r0(r0SEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type spp_gap_t(spp_gap_tSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type max_t(max_tSEXP);
+    Rcpp::traits::input_parameter< const double& >::type min_N(min_NSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type check_every(check_everySEXP);
+    Rcpp::traits::input_parameter< const double& >::type conv_tol(conv_tolSEXP);
+    Rcpp::traits::input_parameter< const bool& >::type show_progress(show_progressSEXP);
+    Rcpp::traits::input_parameter< const uint32_t& >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(quant_gen_warm_cpp(walk, n_chains, V0, N0, add_var, C, D, f, a0, r0, spp_gap_t, max_t, min_N, check_every, conv_tol, show_progress, n_threads));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -356,9 +799,64 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// read_traj_cpp
+List read_traj_cpp(const std::string& file);
+RcppExport SEXP _sauron_read_traj_cpp(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(read_traj_cpp(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// index_traj_cpp
+double index_traj_cpp(const std::string& in_file, const std::string& out_file);
+RcppExport SEXP _sauron_index_traj_cpp(SEXP in_fileSEXP, SEXP out_fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type in_file(in_fileSEXP);
+    Rcpp::traits::input_parameter< const std::string& >::type out_file(out_fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(index_traj_cpp(in_file, out_file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// read_traj_index_cpp
+List read_traj_index_cpp(const std::string& file, const std::vector<uint32_t>& reps, const double& t_min, const double& t_max, const std::vector<uint32_t>& spp);
+RcppExport SEXP _sauron_read_traj_index_cpp(SEXP fileSEXP, SEXP repsSEXP, SEXP t_minSEXP, SEXP t_maxSEXP, SEXP sppSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint32_t>& >::type reps(repsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type t_min(t_minSEXP);
+    Rcpp::traits::input_parameter< const double& >::type t_max(t_maxSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint32_t>& >::type spp(sppSEXP);
+    rcpp_result_gen = Rcpp::wrap(read_traj_index_cpp(file, reps, t_min, t_max, spp));
+    return rcpp_result_gen;
+END_RCPP
+}
+// read_traj_lazy_cpp
+SEXP read_traj_lazy_cpp(const std::string& file, const std::vector<uint32_t>& reps, const double& t_min, const double& t_max, const std::vector<uint32_t>& spp);
+RcppExport SEXP _sauron_read_traj_lazy_cpp(SEXP fileSEXP, SEXP repsSEXP, SEXP t_minSEXP, SEXP t_maxSEXP, SEXP sppSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint32_t>& >::type reps(repsSEXP);
+    Rcpp::traits::input_parameter< const double& >::type t_min(t_minSEXP);
+    Rcpp::traits::input_parameter< const double& >::type t_max(t_maxSEXP);
+    Rcpp::traits::input_parameter< const std::vector<uint32_t>& >::type spp(sppSEXP);
+    rcpp_result_gen = Rcpp::wrap(read_traj_lazy_cpp(file, reps, t_min, t_max, spp));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
     {"_sauron_adapt_dyn_cpp", (DL_FUNC) &_sauron_adapt_dyn_cpp, 19},
+    {"_sauron_hash_raw_cpp", (DL_FUNC) &_sauron_hash_raw_cpp, 1},
+    {"_sauron_invasion_fitness_cpp", (DL_FUNC) &_sauron_invasion_fitness_cpp, 9},
     {"_sauron_sel_str_cpp", (DL_FUNC) &_sauron_sel_str_cpp, 7},
     {"_sauron_dVi_dVi_cpp", (DL_FUNC) &_sauron_dVi_dVi_cpp, 7},
     {"_sauron_dVi_dVk_cpp", (DL_FUNC) &_sauron_dVi_dVk_cpp, 7},
@@ -371,7 +869,26 @@ static const R_CallMethodDef CallEntries[] = {
     {"_sauron_jacobian_cpp", (DL_FUNC) &_sauron_jacobian_cpp, 9},
     {"_sauron_unq_spp_cpp", (DL_FUNC) &_sauron_unq_spp_cpp, 2},
     {"_sauron_group_spp_cpp", (DL_FUNC) &_sauron_group_spp_cpp, 2},
-    {"_sauron_quant_gen_cpp", (DL_FUNC) &_sauron_quant_gen_cpp, 19},
+    {"_sauron_quant_gen_cpp", (DL_FUNC) &_sauron_quant_gen_cpp, 22},
+    {"_sauron_long_output_cpp", (DL_FUNC) &_sauron_long_output_cpp, 5},
+    {"_sauron_quant_gen_basins_cpp", (DL_FUNC) &_sauron_quant_gen_basins_cpp, 24},
+    {"_sauron_quant_gen_continuation_cpp", (DL_FUNC) &_sauron_quant_gen_continuation_cpp, 19},
+    {"_sauron_quant_gen_fork_cpp", (DL_FUNC) &_sauron_quant_gen_fork_cpp, 21},
+    {"_sauron_qg_job_start_cpp", (DL_FUNC) &_sauron_qg_job_start_cpp, 18},
+    {"_sauron_qg_job_status_cpp", (DL_FUNC) &_sauron_qg_job_status_cpp, 1},
+    {"_sauron_qg_job_results_cpp", (DL_FUNC) &_sauron_qg_job_results_cpp, 1},
+    {"_sauron_qg_job_cancel_cpp", (DL_FUNC) &_sauron_qg_job_cancel_cpp, 2},
+    {"_sauron_quant_gen_lyap_cpp", (DL_FUNC) &_sauron_quant_gen_lyap_cpp, 19},
+    {"_sauron_quant_gen_sens_cpp", (DL_FUNC) &_sauron_quant_gen_sens_cpp, 15},
+    {"_sauron_qg_session_cpp", (DL_FUNC) &_sauron_qg_session_cpp, 14},
+    {"_sauron_qg_session_step_cpp", (DL_FUNC) &_sauron_qg_session_step_cpp, 3},
+    {"_sauron_qg_session_add_species_cpp", (DL_FUNC) &_sauron_qg_session_add_species_cpp, 4},
+    {"_sauron_qg_session_snapshot_cpp", (DL_FUNC) &_sauron_qg_session_snapshot_cpp, 1},
+    {"_sauron_qg_session_extract_cpp", (DL_FUNC) &_sauron_qg_session_extract_cpp, 1},
+    {"_sauron_quant_gen_stream_cpp", (DL_FUNC) &_sauron_quant_gen_stream_cpp, 20},
+    {"_sauron_quant_gen_summary_cpp", (DL_FUNC) &_sauron_quant_gen_summary_cpp, 18},
+    {"_sauron_quant_gen_sweep_cpp", (DL_FUNC) &_sauron_quant_gen_sweep_cpp, 20},
+    {"_sauron_quant_gen_warm_cpp", (DL_FUNC) &_sauron_quant_gen_warm_cpp, 17},
     {"_sauron_trunc_rnorm_cpp", (DL_FUNC) &_sauron_trunc_rnorm_cpp, 3},
     {"_sauron_trunc_rnorm_mu_cpp", (DL_FUNC) &_sauron_trunc_rnorm_mu_cpp, 2},
     {"_sauron_trunc_rnorm_sigma_cpp", (DL_FUNC) &_sauron_trunc_rnorm_sigma_cpp, 2},
@@ -379,10 +896,16 @@ static const R_CallMethodDef CallEntries[] = {
     {"_sauron_F_t_cpp", (DL_FUNC) &_sauron_F_t_cpp, 7},
     {"_sauron_F_it_cpp", (DL_FUNC) &_sauron_F_it_cpp, 8},
     {"_sauron_using_openmp", (DL_FUNC) &_sauron_using_openmp, 0},
+    {"_sauron_read_traj_cpp", (DL_FUNC) &_sauron_read_traj_cpp, 1},
+    {"_sauron_index_traj_cpp", (DL_FUNC) &_sauron_index_traj_cpp, 2},
+    {"_sauron_read_traj_index_cpp", (DL_FUNC) &_sauron_read_traj_index_cpp, 5},
+    {"_sauron_read_traj_lazy_cpp", (DL_FUNC) &_sauron_read_traj_lazy_cpp, 5},
     {NULL, NULL, 0}
 };
 
+void init_lazy_altrep(DllInfo* dll);
 RcppExport void R_init_sauron(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    init_lazy_altrep(dll);
 }
@@ -3,9 +3,15 @@
 #include <random>
 #include <progress.hpp>
 #include <progress_bar.hpp>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <climits>
 
 #include "sim.hpp"
 #include "adapt_dyn.hpp"
+#include "lazy_col.hpp"
 
 
 using namespace Rcpp;
@@ -69,13 +75,129 @@ void one_adapt_dyn__(int& status,
 
 
 
+#ifdef SAURON_ALTREP
+
+/*
+ Output from all reps (see `RepOutputAD`), which lazy output columns read
+ from, and which is freed when the last of them is garbage collected.
+ */
+class RepOutputsAD {
+public:
+
+    std::vector<RepOutputAD> reps;
+    std::vector<uint64_t> cum_rows;     // first row for each rep, then total
+    uint32_t q;
+
+    RepOutputsAD(std::vector<RepOutputAD>&& reps_, const uint32_t& q_)
+        : reps(std::move(reps_)), cum_rows(reps.size() + 1, 0), q(q_) {
+        for (uint32_t i = 0; i < reps.size(); i++) {
+            cum_rows[i+1] = cum_rows[i] + reps[i].n_rows();
+        }
+    }
+
+    inline uint64_t n_rows() const { return cum_rows.back(); }
+
+    // Rep that row `w` (for one trait) is in (skipping reps without rows):
+    inline uint64_t find_rep(const uint64_t& w) const {
+        return std::upper_bound(cum_rows.begin(), cum_rows.end(), w) -
+            cum_rows.begin() - 1;
+    }
+
+};
+
+
+enum RepColumnADType {ad_rep, ad_time, ad_clone, ad_trait, ad_N, ad_V};
+
+/*
+ One column of `adapt_dyn_cpp` output, with the same values (and layout) as
+ `RepOutputAD::fill_columns` would write, but read from `RepOutputsAD` when
+ R asks for them.
+ */
+class RepColumnAD : public lazy_col::LazyColumn {
+public:
+
+    std::shared_ptr<const RepOutputsAD> outs;
+    RepColumnADType type;
+
+    RepColumnAD(const std::shared_ptr<const RepOutputsAD>& outs_,
+                const RepColumnADType& type_)
+        : outs(outs_), type(type_) {}
+
+    R_xlen_t length() const {
+        return static_cast<R_xlen_t>(outs->n_rows() * outs->q);
+    }
+    void fill(R_xlen_t i, const R_xlen_t& n_, int* out) const {
+        fill_<int>(i, n_, out);
+    }
+    void fill(R_xlen_t i, const R_xlen_t& n_, double* out) const {
+        fill_<double>(i, n_, out);
+    }
+
+    std::string describe() const {
+        return "adapt_dyn output column " + std::to_string(type);
+    }
+
+private:
+
+    // Fill `out` with values for rows `[i, i + n_)` (traits stacked):
+    template <typename T>
+    void fill_(uint64_t i, const uint64_t& n_, T* out) const {
+        const RepOutputsAD& o(*outs);
+        const uint64_t n_total = o.n_rows();
+        if (n_ == 0) return;
+        uint64_t k = i / n_total;
+        uint64_t w = i % n_total;
+        uint64_t r = o.find_rep(w);
+        for (uint64_t j = 0; j < n_; j++) {
+            while (w >= o.cum_rows[r+1]) r++;
+            get(r, w - o.cum_rows[r], k, out[j]);
+            if (++w == n_total) {
+                // On to the next trait:
+                w = 0;
+                k++;
+                r = o.find_rep(0);
+            }
+        }
+        return;
+    }
+
+    inline void get(const uint64_t& r, const uint64_t& j, const uint64_t& k,
+                    int& x) const {
+        const RepOutputAD& ro(outs->reps[r]);
+        if (type == ad_rep) {
+            x = r;
+        } else if (type == ad_time) {
+            x = ro.time[j];
+        } else if (type == ad_clone) {
+            x = ro.clone[j];
+        } else x = k + 1;
+        return;
+    }
+    inline void get(const uint64_t& r, const uint64_t& j, const uint64_t& k,
+                    double& x) const {
+        const RepOutputAD& ro(outs->reps[r]);
+        if (type == ad_N) {
+            x = ro.N[j];
+        } else x = ro.V[j * outs->q + k];
+        return;
+    }
+
+};
+
+#endif
+
+
+
+
 //' Multiple repetitions of adaptive dynamics.
 //'
+//' Returns a tibble with integer `rep`, `time`, `clone`, and `trait` columns,
+//' and double `N` and `V` columns.
 //'
 //' @noRd
 //'
 //[[Rcpp::export]]
-arma::mat adapt_dyn_cpp(const uint32_t& n_reps,
+List adapt_dyn_cpp(const uint32_t& n_reps,
                         const std::vector<arma::vec>& V0,
                         const std::vector<double>& N0,
                         const double& f,
@@ -113,7 +235,11 @@ arma::mat adapt_dyn_cpp(const uint32_t& n_reps,
         }
     }
 
-    std::vector<OneRepInfoAD> rep_infos(n_reps);
+    /*
+     Output from each rep, made as soon as it's finished.
+     These are what output columns read from (see `RepOutputAD`).
+     */
+    std::vector<RepOutputAD> rep_outs(n_reps);
 
     const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_reps);
 
@@ -139,11 +265,14 @@ arma::mat adapt_dyn_cpp(const uint32_t& n_reps,
     #pragma omp for schedule(static)
     #endif
     for (uint32_t i = 0; i < n_reps; i++) {
+        // (Freed at the end of each iteration)
+        OneRepInfoAD info;
         eng.seed(seeds[i][0], seeds[i][1]);
-        one_adapt_dyn__(status, rep_infos[i], V0, N0, f, a0, C, r0, D,
+        one_adapt_dyn__(status, info, V0, N0, f, a0, C, r0, D,
                         sigma_V0, sigma_N, sigma_V, max_t, min_N,
                         mut_sd, mut_prob, max_clones,
                         save_every, eng, prog_bar);
+        if (status == 0) rep_outs[i] = RepOutputAD(info);
 
     }
     if (active_thread == 0 && status != 0) interrupted = true;
@@ -155,33 +284,78 @@ arma::mat adapt_dyn_cpp(const uint32_t& n_reps,
         throw(Rcpp::exception("\nUser interrupted process.", false));
     }
 
+#ifdef SAURON_ALTREP
+
+    /*
+     Where R supports it, output columns are lazy and read straight from
+     `rep_outs`, so output is only stored once.
+     */
+    std::shared_ptr<const RepOutputsAD> outs =
+        std::make_shared<const RepOutputsAD>(std::move(rep_outs), q);
+    const uint64_t n_out = outs->n_rows() * q;
+    if (n_out > static_cast<uint64_t>(INT_MAX)) {
+        stop("\nToo many rows (" + std::to_string(n_out) +
+            ") for one data frame; use fewer reps or save less often");
+    }
+    const std::vector<std::string> col_names = {"rep", "time", "clone", "N",
+                                                "trait", "V"};
+    const std::vector<RepColumnADType> col_types = {ad_rep, ad_time, ad_clone,
+                                                    ad_N, ad_trait, ad_V};
+    List output(col_names.size());
+    for (uint32_t j = 0; j < col_names.size(); j++) {
+        const bool is_int = col_types[j] != ad_N && col_types[j] != ad_V;
+        output[j] = lazy_col::new_lazy_column(
+            new RepColumnAD(outs, col_types[j]), is_int);
+    }
+    output.attr("names") = CharacterVector(col_names.begin(), col_names.end());
+
+#else
+
     /*
      Go through one time to calculate the # surviving species for all reps and
      for all time point(s) saved.
      Then go back through and fill in values.
     */
-    uint32_t n_rows = rep_infos[0].n_rows();
-    std::vector<uint32_t> cum_rows(n_reps, 0);
+    uint64_t n_rows = rep_outs[0].n_rows();
+    std::vector<uint64_t> cum_rows(n_reps, 0);
     cum_rows[0] = n_rows;
     for (uint32_t i = 1; i < n_reps; i++) {
-        uint32_t nr = rep_infos[i].n_rows();
+        uint64_t nr = rep_outs[i].n_rows();
         n_rows += nr;
         cum_rows[i] = nr + cum_rows[i-1];
     }
-    // Make output matrix:
-    arma::mat output(n_rows, 4 + q);
-    // Fill output matrix:
+    // Make output columns:
+    const R_xlen_t n_out = static_cast<R_xlen_t>(n_rows * q);
+    IntegerVector rep(n_out), time(n_out), clone(n_out), trait(n_out);
+    NumericVector N(n_out), V(n_out);
+    int* rep_ = rep.begin();
+    int* time_ = time.begin();
+    int* clone_ = clone.begin();
+    int* trait_ = trait.begin();
+    double* N_ = N.begin();
+    double* V_ = V.begin();
+    // Fill output columns:
     #ifdef _OPENMP
     #pragma omp parallel for default(shared) num_threads(n_threads) schedule(static)
     #endif
     for (uint32_t i = 0; i < n_reps; i++) {
-        uint32_t start = 0;
+        uint64_t start = 0;
         if (i > 0) start = cum_rows[i-1];
-        rep_infos[i].fill_matrix(output, i, start);
+        rep_outs[i].fill_columns(rep_, time_, clone_, N_, trait_, V_,
+                                 i, start, n_rows);
+        rep_outs[i] = RepOutputAD();
     }
 
+    List output = List::create(_["rep"] = rep, _["time"] = time,
+                               _["clone"] = clone, _["N"] = N,
+                               _["trait"] = trait, _["V"] = V);
 
+#endif
 
+    output.attr("row.names") = IntegerVector::create(
+        NA_INTEGER, -static_cast<int>(n_out));
+    output.attr("class") = CharacterVector::create("tbl_df", "tbl",
+                                                   "data.frame");
 
     return output;
 }
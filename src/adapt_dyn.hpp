@@ -213,52 +213,89 @@ public:
     }
 
 
-    /*
-     Fill a matrix with data from this rep.
-     The matrix has the following columns:
-       0  - rep
-       1  - time
-       2  - clone index
-       3  - abundance
-       ≥4 - clone trait values
-     */
-    void fill_matrix(arma::mat& matrix,
-                     const double& rep_number,
-                     uint32_t start_row) const {
+private:
 
-        uint32_t q = all_V[0].n_elem;
-        double rn = static_cast<double>(rep_number);
+    double mut_sd_;
+    normal_distr rand_norm = normal_distr(0, 1);
 
-        for (uint32_t i = 0; i < all_N.size(); i++) {
+};
 
-            uint32_t nr = all_N[i].size();
-            double t = static_cast<double>(all_t[i]);
 
-            for (uint32_t j = 0; j < nr; j++) {
 
-                matrix(start_row + j, 0) = rn;
-                matrix(start_row + j, 1) = t;
-                matrix(start_row + j, 2) = all_I[i][j];
-                matrix(start_row + j, 3) = all_N[i][j];
 
-                for (uint32_t k = 0; k < q; k++) {
-                    matrix(start_row + j, 4 + k) = all_V[all_I[i][j]][k];
-                }
+/*
+ Compact output from one finished rep, with one row per clone and saved time,
+ and traits stored contiguously (`q` values per row).
+ This is made from a `OneRepInfoAD` by the thread that finished the rep, so
+ the `OneRepInfoAD` can be freed right away instead of being kept until all
+ reps are done.
+ As for `RepOutput` in `quant_gen.hpp`, output columns read from these
+ lazily (see `RepColumnAD` in `adapt_dyn.cpp`), and `fill_columns` is only
+ used where R doesn't support lazy columns.
+ */
+class RepOutputAD {
+public:
 
+    uint32_t q;
+    std::vector<uint32_t> time;
+    std::vector<uint32_t> clone;
+    std::vector<double> N;
+    std::vector<double> V;
+
+    RepOutputAD() : q(0), time(), clone(), N(), V() {}
+    RepOutputAD(const OneRepInfoAD& info)
+        : q(info.all_V[0].n_elem), time(), clone(), N(), V() {
+
+        const uint64_t nr = info.n_rows();
+        time.reserve(nr);
+        clone.reserve(nr);
+        N.reserve(nr);
+        V.reserve(nr * q);
+
+        for (uint32_t i = 0; i < info.all_N.size(); i++) {
+            for (uint32_t j = 0; j < info.all_N[i].size(); j++) {
+                const arma::vec& V_(info.all_V[info.all_I[i][j]]);
+                time.push_back(info.all_t[i]);
+                clone.push_back(info.all_I[i][j]);
+                N.push_back(info.all_N[i][j]);
+                V.insert(V.end(), V_.begin(), V_.end());
             }
+        }
 
-            start_row += nr;
+    }
+
+    inline uint64_t n_rows() const { return N.size(); }
 
+    /*
+     Fill typed output columns with data from this rep.
+     Columns are rep, time, clone index, abundance, trait index, and trait
+     value, and rows for each trait are stacked on top of each other
+     (so there are `n_total` rows for each trait).
+     */
+    void fill_columns(int* rep,
+                      int* time_,
+                      int* clone_,
+                      double* N_,
+                      int* trait,
+                      double* V_,
+                      const int& rep_number,
+                      const uint64_t& start_row,
+                      const uint64_t& n_total) const {
+
+        for (uint64_t j = 0; j < n_rows(); j++) {
+            for (uint32_t k = 0; k < q; k++) {
+                const uint64_t r = k * n_total + start_row + j;
+                rep[r] = rep_number;
+                time_[r] = time[j];
+                clone_[r] = clone[j];
+                N_[r] = N[j];
+                trait[r] = k + 1;
+                V_[r] = V[j * q + k];
+            }
         }
         return;
     }
 
-
-private:
-
-    double mut_sd_;
-    normal_distr rand_norm = normal_distr(0, 1);
-
 };
 
 
@@ -0,0 +1,39 @@
+
+#include <Rcpp.h>
+#include <string>
+#include <cstdio>
+
+using namespace Rcpp;
+
+
+
+/*
+ Hashing for the on-disk result cache.
+ */
+
+
+
+//' 64-bit FNV-1a hash of a raw vector.
+//'
+//' Used to hash serialized inputs for the result cache.
+//' Returns the hash as a 16-character hexadecimal string.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+std::string hash_raw_cpp(const RawVector& x) {
+
+    uint64_t h = 14695981039346656037ULL;
+    const uint64_t prime = 1099511628211ULL;
+
+    const Rbyte* bytes = RAW(x);
+    for (R_xlen_t i = 0; i < x.size(); i++) {
+        h ^= static_cast<uint64_t>(bytes[i]);
+        h *= prime;
+    }
+
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+
+    return std::string(buf);
+}
@@ -0,0 +1,94 @@
+
+
+#include <RcppArmadillo.h>
+#include <vector>
+
+#include "sim.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Growth of rare invaders into a resident community.
+
+ When an invader's abundance goes to zero, it has no effect on itself or
+ on the residents.
+ Its fitness then only depends on its own traits and on
+ `W = sum(N_j * exp(- transpose(V_j) * D * V_j))` over all residents `j`,
+ which is the same for every invader.
+ */
+
+
+
+//' Invasion growth rates and selection gradients for many invaders.
+//'
+//' `V` and `N` are the resident community's traits (one column per species)
+//' and abundances.
+//' `V_inv` contains one column of traits per invader.
+//'
+//' Returns a list with `growth`, the log of each invader's fitness
+//' (i.e., its per-capita growth rate when rare),
+//' and `gradient`, a `q` by `n_inv` matrix of the derivative of fitness with
+//' respect to the invader's traits divided by its fitness
+//' (i.e., the same as `sel_str_cpp` for an invader with `N = 0`).
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List invasion_fitness_cpp(const arma::mat& V,
+                          const std::vector<double>& N,
+                          const arma::mat& V_inv,
+                          const double& f,
+                          const double& a0,
+                          const arma::mat& C,
+                          const double& r0,
+                          const arma::mat& D,
+                          const uint32_t& n_threads) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+
+    uint32_t n = V.n_cols;
+    uint32_t q = V_inv.n_rows;
+    uint32_t n_inv = V_inv.n_cols;
+
+    if (n != N.size()) stop("V.n_cols != N.size()");
+    if (n > 0 && V.n_rows != q) stop("V.n_rows != V_inv.n_rows");
+    if (C.n_cols != q) stop("C.n_cols != q");
+    if (C.n_rows != q) stop("C.n_rows != q");
+    if (D.n_cols != q) stop("D.n_cols != q");
+    if (D.n_rows != q) stop("D.n_rows != q");
+
+    // Resident effect on any invader:
+    double W = 0;
+    for (uint32_t j = 0; j < n; j++) {
+        W += N[j] * std::exp(-1 * arma::as_scalar(V.col(j).t() * D * V.col(j)));
+    }
+
+    NumericVector growth(n_inv);
+    arma::mat gradient(q, n_inv);
+
+    // Raw pointer so that no R API is used inside the parallel loop:
+    double* growth_ptr = growth.begin();
+
+    #ifdef _OPENMP
+    #pragma omp parallel for default(shared) num_threads(n_threads) schedule(static) if (n_threads > 1)
+    #endif
+    for (uint32_t k = 0; k < n_inv; k++) {
+        const arma::subview_col<double>& v(V_inv.col(k));
+        double z = a0 * W * std::exp(-1 * arma::as_scalar(v.t() * v));
+        growth_ptr[k] = r_V_<arma::subview_col<double>>(v, f, C, r0) - z;
+        gradient.col(k) = 2 * (-f * C * v + z * v);
+    }
+
+    List out = List::create(_["growth"] = growth, _["gradient"] = gradient);
+
+    return out;
+}
+
@@ -0,0 +1,139 @@
+
+#include <RcppArmadillo.h>
+#include <algorithm>
+
+#include "lazy_col.hpp"
+
+
+using namespace Rcpp;
+
+
+
+/*
+ ALTREP classes for lazy integer and double columns (see `lazy_col.hpp`).
+ `data1` is an external pointer to a `LazyColumn`, and `data2` is
+ `NULL` until something asks for a pointer to the data, in which case
+ values are all copied to a regular vector that's kept there.
+ */
+
+
+namespace lazy_col {
+
+#ifdef SAURON_ALTREP
+
+R_altrep_class_t lazy_int_class;
+R_altrep_class_t lazy_real_class;
+
+inline const LazyColumn& lazy_column(SEXP x) {
+    return *static_cast<LazyColumn*>(R_ExternalPtrAddr(R_altrep_data1(x)));
+}
+inline int* lazy_ptr(SEXP x, const int*) { return INTEGER(x); }
+inline double* lazy_ptr(SEXP x, const double*) { return REAL(x); }
+inline int lazy_rtype(const int*) { return INTSXP; }
+inline int lazy_rtype(const double*) { return REALSXP; }
+
+R_xlen_t lazy_length(SEXP x) {
+    return lazy_column(x).length();
+}
+
+template <typename T>
+void* lazy_dataptr(SEXP x, Rboolean writeable) {
+    SEXP data2 = R_altrep_data2(x);
+    if (data2 == R_NilValue) {
+        const LazyColumn& lc(lazy_column(x));
+        lc.check();
+        const R_xlen_t len = lc.length();
+        data2 = PROTECT(Rf_allocVector(lazy_rtype((T*) NULL), len));
+        lc.fill(0, len, lazy_ptr(data2, (T*) NULL));
+        R_set_altrep_data2(x, data2);
+        UNPROTECT(1);
+    }
+    return lazy_ptr(data2, (T*) NULL);
+}
+
+template <typename T>
+const void* lazy_dataptr_or_null(SEXP x) {
+    SEXP data2 = R_altrep_data2(x);
+    if (data2 == R_NilValue) return NULL;
+    return lazy_ptr(data2, (T*) NULL);
+}
+
+template <typename T>
+T lazy_elt(SEXP x, R_xlen_t i) {
+    SEXP data2 = R_altrep_data2(x);
+    if (data2 != R_NilValue) return lazy_ptr(data2, (T*) NULL)[i];
+    const LazyColumn& lc(lazy_column(x));
+    lc.check();
+    T out;
+    lc.fill(i, 1, &out);
+    return out;
+}
+
+template <typename T>
+R_xlen_t lazy_get_region(SEXP x, R_xlen_t i, R_xlen_t n_, T* buf) {
+    const R_xlen_t len = lazy_length(x);
+    if (i >= len) return 0;
+    if (n_ > len - i) n_ = len - i;
+    SEXP data2 = R_altrep_data2(x);
+    if (data2 != R_NilValue) {
+        const T* data = lazy_ptr(data2, buf);
+        std::copy(data + i, data + i + n_, buf);
+    } else {
+        const LazyColumn& lc(lazy_column(x));
+        lc.check();
+        lc.fill(i, n_, buf);
+    }
+    return n_;
+}
+
+Rboolean lazy_inspect(SEXP x, int pre, int deep, int pvec,
+                      void (*inspect_subtree)(SEXP, int, int, int)) {
+    Rprintf("sauron lazy column (%s, %s)\n",
+            lazy_column(x).describe().c_str(),
+            (R_altrep_data2(x) == R_NilValue) ? "lazy" : "materialized");
+    return TRUE;
+}
+
+SEXP new_lazy_column(LazyColumn* col, const bool& is_int) {
+    XPtr<LazyColumn> lc(col, true);
+    if (is_int) return R_new_altrep(lazy_int_class, lc, R_NilValue);
+    return R_new_altrep(lazy_real_class, lc, R_NilValue);
+}
+
+#endif
+
+}
+
+
+
+// Register ALTREP classes when the package is loaded:
+// [[Rcpp::init]]
+void init_lazy_altrep(DllInfo* dll) {
+
+#ifdef SAURON_ALTREP
+
+    using namespace lazy_col;
+
+    lazy_int_class = R_make_altinteger_class("lazy_int", "sauron", dll);
+    R_set_altrep_Length_method(lazy_int_class, lazy_length);
+    R_set_altrep_Inspect_method(lazy_int_class, lazy_inspect);
+    R_set_altvec_Dataptr_method(lazy_int_class, lazy_dataptr<int>);
+    R_set_altvec_Dataptr_or_null_method(lazy_int_class,
+                                        lazy_dataptr_or_null<int>);
+    R_set_altinteger_Elt_method(lazy_int_class, lazy_elt<int>);
+    R_set_altinteger_Get_region_method(lazy_int_class, lazy_get_region<int>);
+
+    lazy_real_class = R_make_altreal_class("lazy_real", "sauron", dll);
+    R_set_altrep_Length_method(lazy_real_class, lazy_length);
+    R_set_altrep_Inspect_method(lazy_real_class, lazy_inspect);
+    R_set_altvec_Dataptr_method(lazy_real_class, lazy_dataptr<double>);
+    R_set_altvec_Dataptr_or_null_method(lazy_real_class,
+                                        lazy_dataptr_or_null<double>);
+    R_set_altreal_Elt_method(lazy_real_class, lazy_elt<double>);
+    R_set_altreal_Get_region_method(lazy_real_class, lazy_get_region<double>);
+
+#endif
+
+    return;
+
+}
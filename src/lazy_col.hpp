@@ -0,0 +1,78 @@
+#ifndef __SAURON_LAZY_COL_H
+#define __SAURON_LAZY_COL_H
+
+
+#include <RcppArmadillo.h>
+#include <string>
+#include <Rversion.h>
+
+// Lazy (ALTREP) columns need R >= 3.6.0:
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 6, 0)
+#include <R_ext/Altrep.h>
+#define SAURON_ALTREP
+#endif
+
+using namespace Rcpp;
+
+
+
+/*
+ Lazy columns of output.
+
+ A `LazyColumn` computes values for any range of rows on request, from data
+ that's stored in some other (usually more compact) form.
+ `new_lazy_column` wraps one in an ALTREP integer or double vector, so
+ R only sees a regular vector, but nothing is copied into R until something
+ asks for a pointer to all of a column's data.
+ Trajectory files (`traj_io.cpp`), and `quant_gen_cpp` and `adapt_dyn_cpp`
+ output use these.
+ */
+
+
+namespace lazy_col {
+
+class LazyColumn {
+public:
+
+    virtual ~LazyColumn() {}
+
+    // Number of values:
+    virtual R_xlen_t length() const = 0;
+
+    // Fill `out` with values `[i, i + n)` (only the one for its type is used):
+    virtual void fill(R_xlen_t i, const R_xlen_t& n, int* out) const {
+        return;
+    }
+    virtual void fill(R_xlen_t i, const R_xlen_t& n, double* out) const {
+        return;
+    }
+
+    /*
+     Called before values are filled.
+     This should use `Rf_error` (not `stop`, since it's called by R, not Rcpp)
+     if the values can't be read anymore.
+     */
+    virtual void check() const {
+        return;
+    }
+
+    // Short description for `.Internal(inspect(x))`:
+    virtual std::string describe() const = 0;
+
+};
+
+
+#ifdef SAURON_ALTREP
+
+/*
+ Make an ALTREP vector from a column, which it then owns.
+ It's an integer vector if `is_int` is true, a double vector otherwise.
+ */
+SEXP new_lazy_column(LazyColumn* col, const bool& is_int);
+
+#endif
+
+}
+
+
+#endif
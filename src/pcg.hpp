@@ -82,6 +82,46 @@ inline std::vector<std::vector<uint128_t>> mc_seeds_rep(const uint32_t& n_reps)
 
 
 
+// Same as above, but returns the raw 32-bit seeds (one column per rep)
+// so they can be stored and later used to replay reps.
+// Doubles can hold these exactly.
+inline arma::mat mc_raw_seeds_rep(const uint32_t& n_reps) {
+
+    arma::mat raw(8, n_reps);
+
+    for (uint32_t i = 0; i < n_reps; i++) {
+        for (uint32_t j = 0; j < 8; j++) {
+            raw(j,i) = static_cast<double>(
+                static_cast<uint64_t>(R::runif(0,4294967296)));
+        }
+    }
+
+    return raw;
+}
+
+// Seeds for each rep from raw seeds made by `mc_raw_seeds_rep`
+inline std::vector<std::vector<uint128_t>> seeds_from_raw(const arma::mat& raw) {
+
+    if (raw.n_rows != 8) stop("raw seeds must have 8 rows");
+
+    std::vector<std::vector<uint128_t>> sub_seeds(raw.n_cols,
+                                                  std::vector<uint128_t>(2));
+
+    std::vector<uint64_t> tmp(8);
+
+    for (uint32_t i = 0; i < raw.n_cols; i++) {
+        for (uint32_t j = 0; j < 8; j++) {
+            tmp[j] = static_cast<uint64_t>(raw(j,i));
+        }
+        fill_seeds(tmp, sub_seeds[i][0], sub_seeds[i][1]);
+    }
+
+    return sub_seeds;
+}
+
+
+
+
 /*
  For single-core operations, you can use R's RNG for 32-bit random number generation.
  */
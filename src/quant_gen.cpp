@@ -6,10 +6,17 @@
 #include <random>
 #include <vector>
 #include <deque>
+#include <string>
+#include <numeric>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <climits>
 
 #include "sim.hpp"
 #include "pcg.hpp"
 #include "quant_gen.hpp"
+#include "lazy_col.hpp"
 
 #ifdef _OPENMP
 #include <omp.h>  // omp
@@ -37,14 +44,14 @@ using namespace Rcpp;
 //'
 //' @noRd
 //'
-inline void sel_str__(arma::mat& ss_mat,
-                      const std::vector<arma::vec>& V,
-                      const std::vector<double>& N,
-                      const double& f,
-                      const double& a0,
-                      const arma::mat& C,
-                      const double& r0,
-                      const arma::mat& D) {
+void sel_str__(arma::mat& ss_mat,
+               const std::vector<arma::vec>& V,
+               const std::vector<double>& N,
+               const double& f,
+               const double& a0,
+               const arma::mat& C,
+               const double& r0,
+               const arma::mat& D) {
 
     uint32_t n = V.size();      // # species
     uint32_t q = V[0].n_elem;   // # traits
@@ -824,6 +831,241 @@ arma::mat jacobian_cpp(const arma::mat& V,
 
 
 
+//' Jacobian of one time step, as the simulations are run.
+//'
+//' This differs from `jacobian_cpp` in that traits change after abundances
+//' (i.e., they use abundances at t+1), so the trait rows are evaluated at
+//' `N1` and their derivatives with respect to abundances are chained
+//' through the abundance rows.
+//' `V` and `Vp` are genotypes and phenotypes at time t, `N` and `N1` are
+//' abundances at times t and t+1, and `ss_mat` is selection strength using
+//' `Vp` and `N1`.
+//' Noise in abundances and phenotypes is included (as fixed shocks), from
+//' how `N1` differs from its deterministic value and how `Vp` differs
+//' from `V`.
+//' `dV_dN1` is set to derivatives of traits at t+1 with respect to
+//' abundances at t+1, for chaining other derivatives.
+//'
+//' Cell [i,j] contains the partial derivative of i with respect to j.
+//'
+//' NOTE: This DOES account for step function to keep traits >= 0
+//'
+//' @noRd
+//'
+void step_jacobian__(arma::mat& jcb_mat,
+                     arma::mat& dV_dN1,
+                     const std::vector<arma::vec>& V,
+                     const std::vector<arma::vec>& Vp,
+                     const std::vector<double>& N,
+                     const std::vector<double>& N1,
+                     const std::vector<double>& add_var,
+                     const arma::mat& ss_mat,
+                     const double& f,
+                     const double& a0,
+                     const arma::mat& C,
+                     const double& r0,
+                     const arma::mat& D) {
+
+    const uint32_t n = V.size();
+    const uint32_t q = V[0].n_elem;
+    const uint32_t nq = n * q;
+    const uint32_t m = nq + n;
+
+    arma::mat Vm(q, n);
+    for (uint32_t i = 0; i < n; i++) Vm.col(i) = Vp[i];
+
+    arma::vec expVDV(n);
+    for (uint32_t j = 0; j < n; j++) {
+        expVDV(j) = std::exp(-1 * arma::as_scalar(Vp[j].t() * D * Vp[j]));
+    }
+
+    jcb_mat.zeros(m, m);
+
+    for (uint32_t i = 0; i < n; i++) {
+
+        const arma::vec& Vi(Vp[i]);
+
+        /*
+         Traits at t+1 (using abundances at t+1):
+         */
+        double Omega1 = 0;
+        for (uint32_t j = 0; j < n; j++) {
+            if (j != i) Omega1 += N1[j] * expVDV(j);
+        }
+        for (uint32_t k = 0; k < n; k++) {
+            if (k == i) {
+                dVi_dVi_(jcb_mat, i * q, k * q, Vi, Omega1, C, f, a0,
+                         add_var[i]);
+                dVi_dNi_(jcb_mat, i * q, nq + k, Vi, a0, add_var[i]);
+            } else {
+                dVi_dVk_(jcb_mat, i * q, k * q, N1[k], Vi, Vp[k], D, a0,
+                         add_var[i]);
+                dVi_dNk_(jcb_mat, i * q, nq + k, Vi, Vp[k], D, a0,
+                         add_var[i]);
+            }
+        }
+
+        /*
+         Abundances at t+1 (using traits and abundances at t):
+         */
+        for (uint32_t k = 0; k < n; k++) {
+            if (k == i) {
+                dNi_dVi_(jcb_mat, nq + i, k * q, i, Vm, N, f, a0, C, r0, D);
+                dNi_dNi_(jcb_mat, nq + i, nq + k, i, Vm, N, f, a0, C, r0, D);
+            } else {
+                dNi_dVk_(jcb_mat, nq + i, k * q, i, k, Vm, N, f, a0, C, r0, D);
+                dNi_dNk_(jcb_mat, nq + i, nq + k, i, k, Vm, N, f, a0, C, r0, D);
+            }
+        }
+        // Abundance noise multiplies fitness (this is 1 without noise):
+        double noise = N1[i] / (N[i] * F_it__(i, Vm, N, f, a0, C, r0, D));
+        jcb_mat.row(nq + i) *= noise;
+    }
+
+    // Chain trait rows through abundances at t+1:
+    dV_dN1 = jcb_mat.submat(0, nq, nq - 1, m - 1);
+    jcb_mat.submat(0, nq, nq - 1, m - 1).zeros();
+    jcb_mat.head_rows(nq) += dV_dN1 * jcb_mat.tail_rows(n);
+
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < q; j++) {
+            const uint32_t c = i * q + j;
+            /*
+             Genotypes change by selection on phenotypes, so derivatives
+             with respect to genotypes (other than the genotype itself)
+             are scaled by d(phenotype) / d(genotype):
+             */
+            if (V[i](j) > 0 && Vp[i](j) != V[i](j)) {
+                jcb_mat(c, c) -= 1;
+                jcb_mat.col(c) *= (Vp[i](j) / V[i](j));
+                jcb_mat(c, c) += 1;
+            }
+            // Heaviside function for traits kept >= 0:
+            if (V[i](j) + add_var[i] * ss_mat(j,i) <= 0) jcb_mat.row(c).zeros();
+        }
+    }
+
+    return;
+}
+
+
+
+
+//' One time step of forward sensitivities to parameters.
+//'
+//' `sens` has one matrix per species, with rows for traits then abundance,
+//' and columns for `f`, `a0`, `r0`, `eta`, and `d`.
+//' On input it has sensitivities at time t, and on output at time t+1.
+//' Arguments are the same as for `step_jacobian__`, where there should be
+//' no noise (i.e., `V` and `Vp` are the same).
+//' `dC` and `dD` are derivatives of `C` and `D` with respect to `eta`
+//' and `d`.
+//'
+//' NOTE: This DOES account for step function to keep traits >= 0
+//'
+//' @noRd
+//'
+void sens_step__(std::vector<arma::mat>& sens,
+                 const std::vector<arma::vec>& V,
+                 const std::vector<arma::vec>& Vp,
+                 const std::vector<double>& N,
+                 const std::vector<double>& N1,
+                 const std::vector<double>& add_var,
+                 const arma::mat& ss_mat,
+                 const double& f,
+                 const double& a0,
+                 const arma::mat& C,
+                 const double& r0,
+                 const arma::mat& D,
+                 const arma::mat& dC,
+                 const arma::mat& dD) {
+
+    const uint32_t n = V.size();
+    const uint32_t q = V[0].n_elem;
+    const uint32_t nq = n * q;
+    const uint32_t m = nq + n;
+
+    arma::mat jcb_mat;
+    arma::mat dV_dN1;
+    step_jacobian__(jcb_mat, dV_dN1, V, Vp, N, N1, add_var, ss_mat,
+                    f, a0, C, r0, D);
+
+    // `exp(-transpose(V_j) * D * V_j)` and `transpose(V_j) * dD * V_j`:
+    arma::vec expVDV(n);
+    arma::vec VdDV(n);
+    for (uint32_t j = 0; j < n; j++) {
+        expVDV(j) = std::exp(-1 * arma::as_scalar(Vp[j].t() * D * Vp[j]));
+        VdDV(j) = arma::as_scalar(Vp[j].t() * dD * Vp[j]);
+    }
+
+    // Derivatives of one time step with respect to parameters:
+    arma::mat dG(m, 5, arma::fill::zeros);
+
+    for (uint32_t i = 0; i < n; i++) {
+
+        const arma::vec& Vi(Vp[i]);
+        const double expVV = std::exp(-1 * arma::as_scalar(Vi.t() * Vi));
+
+        // Traits at t+1 (using abundances at t+1):
+        double Omega1 = 0;
+        double dOmega1 = 0;
+        for (uint32_t j = 0; j < n; j++) {
+            if (j == i) continue;
+            Omega1 += N1[j] * expVDV(j);
+            dOmega1 -= N1[j] * expVDV(j) * VdDV(j);
+        }
+        const uint32_t row0 = i * q;
+        const uint32_t row1 = i * q + q - 1;
+        dG.submat(row0, 0, row1, 0) = -2 * add_var[i] * C * Vi;
+        dG.submat(row0, 1, row1, 1) = 2 * add_var[i] * Omega1 * expVV * Vi;
+        dG.submat(row0, 3, row1, 3) = -2 * add_var[i] * f * dC * Vi;
+        dG.submat(row0, 4, row1, 4) = 2 * add_var[i] * a0 * dOmega1 * expVV * Vi;
+
+        // Abundances at t+1 (using traits and abundances at t):
+        double A = N[i];
+        double dA = 0;
+        for (uint32_t j = 0; j < n; j++) {
+            if (j == i) continue;
+            A += N[j] * expVV * expVDV(j);
+            dA -= N[j] * expVV * expVDV(j) * VdDV(j);
+        }
+        dG(nq + i, 0) = -1 * N1[i] * arma::as_scalar(Vi.t() * C * Vi);
+        dG(nq + i, 1) = -1 * N1[i] * A;
+        dG(nq + i, 2) = N1[i];
+        dG(nq + i, 3) = -1 * N1[i] * f * arma::as_scalar(Vi.t() * dC * Vi);
+        dG(nq + i, 4) = -1 * N1[i] * a0 * dA;
+    }
+
+    // Chain trait rows through abundances at t+1:
+    dG.head_rows(nq) += dV_dN1 * dG.tail_rows(n);
+
+    arma::mat S(m, 5);
+    for (uint32_t i = 0; i < n; i++) {
+        S.rows(i * q, i * q + q - 1) = sens[i].head_rows(q);
+        S.row(nq + i) = sens[i].row(q);
+    }
+
+    S = jcb_mat * S + dG;
+
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < q; j++) {
+            // Heaviside function for traits kept >= 0:
+            if (V[i](j) + add_var[i] * ss_mat(j,i) <= 0) {
+                S.row(i * q + j).zeros();
+            }
+        }
+        sens[i].head_rows(q) = S.rows(i * q, i * q + q - 1);
+        sens[i].row(q) = S.row(nq + i);
+    }
+
+    return;
+}
+
+
+
+
+
+
 //' Search for unique species in a matrix of species trait values.
 //'
 //' @noRd
@@ -900,212 +1142,371 @@ IntegerVector group_spp_cpp(const std::vector<arma::vec>& V,
 
 
 
-//' One repetition of quantitative genetics.
-//'
-//' Higher-up function(s) should handle the info put into `info`.
-//'
-//'
-//' @noRd
-//'
-void one_quant_gen__(int& status,
-                     OneRepInfo& info,
-                     std::deque<arma::vec> V0,
-                     std::deque<arma::vec> Vp0,
-                     std::deque<double> N0,
-                     const double& f,
-                     const double& a0,
-                     const arma::mat& C,
-                     const double& r0,
-                     const arma::mat& D,
-                     std::deque<double> add_var,
-                     const double& sigma_V0,
-                     const double& sigma_N,
-                     const std::vector<double>& sigma_V,
-                     const uint32_t& spp_gap_t,
-                     const uint32_t& final_t,
-                     const double& min_N,
-                     const uint32_t& save_every,
-                     pcg64& eng,
-                     Progress& prog_bar) {
-
-    if (status != 0) return; // previous user interrupt
-
+/*
+ Makes factor levels "1", "2", ..., `n`.
+ */
+inline CharacterVector int_levels__(const int& n) {
+    CharacterVector levels(std::max(n, 0));
+    for (int i = 0; i < n; i++) levels[i] = std::to_string(i + 1);
+    return levels;
+}
 
-    uint32_t n = N0.size();
-    uint32_t q = V0.front().n_elem;
+/*
+ Typed, long-format output (one row per species, time, and axis) that's
+ returned to R as a tibble.
+
+ There are ID columns (e.g., rep, time, and species), then `axis`, `N`,
+ `geno`, and `pheno` (only if `pheno` is `true`).
+ ID columns and `axis` are integers, and the rest are doubles.
+ For each ID column, `id_levels` indicates whether it's left as an
+ integer (`-1`), or made a factor with levels `1:max(x)` (`0`) or
+ `1:id_levels[i]` (`> 0`).
+ Values outside a factor's levels (e.g., species of 0 when everything's
+ extinct) become `NA`, as do `NaN` genotypes and phenotypes.
+ `set_id` and `set_values` only write through raw pointers, so different
+ threads can fill different rows at the same time.
+ */
+class LongOutput {
+public:
+
+    LongOutput(const std::vector<std::string>& id_names_,
+               const std::vector<int>& id_levels_,
+               const uint32_t& q_,
+               const bool& pheno_,
+               const uint64_t& n_rows)
+        : id_names(id_names_), id_levels(id_levels_),
+          q(q_), pheno(pheno_),
+          ids(id_names_.size()),
+          N(static_cast<R_xlen_t>(n_rows * q_)),
+          geno(static_cast<R_xlen_t>(n_rows * q_)),
+          pheno_col(pheno_ ? static_cast<R_xlen_t>(n_rows * q_) : 0),
+          id_ptrs(id_names_.size()),
+          N_ptr(N.begin()), geno_ptr(geno.begin()),
+          pheno_ptr(pheno_col.begin()) {
+        if (id_levels.size() != id_names.size()) {
+            stop("\nid_levels.size() != id_names.size()");
+        }
+        for (uint32_t c = 0; c < ids.size(); c++) {
+            ids[c] = IntegerVector(N.size());
+            id_ptrs[c] = ids[c].begin();
+        }
+    }
 
-    normal_distr distr = normal_distr(0, 1);
+    // Set ID column `c` for row `i` (row in wide format):
+    inline void set_id(const uint64_t& i, const uint32_t& c, const double& x) {
+        const int v = (id_levels[c] > 0 && (x < 1 || x > id_levels[c])) ?
+            NA_INTEGER : static_cast<int>(x);
+        int* ptr = id_ptrs[c] + i * q;
+        for (uint32_t l = 0; l < q; l++) ptr[l] = v;
+        return;
+    }
 
-    // adding stochasticity to starting genotypes (and phenotypes if desired)
-    if (sigma_V0 > 0) {
-        Vp0 = V0; // mostly just to resize `Vp0`
-        for (uint32_t i = 0; i < n; i++) {
-            for (uint32_t j = 0; j < q; j++) {
-                V0[i][j] = trunc_rnorm_(V0[i][j], sigma_V0, eng);
-                Vp0[i][j] = V0[i][j];
-                if (sigma_V[j] > 0) {
-                    Vp0[i][j] *= std::exp(distr(eng) * sigma_V[j]);
-                }
-            }
+    // Set abundance, genotypes, and phenotypes for row `i`:
+    template <typename T>
+    inline void set_values(const uint64_t& i, const double& N_,
+                           const T& V, const T& Vp) {
+        const uint64_t j0 = i * q;
+        for (uint32_t l = 0; l < q; l++) {
+            N_ptr[j0 + l] = N_;
+            geno_ptr[j0 + l] = std::isnan(V[l]) ? NA_REAL : V[l];
+            if (pheno) pheno_ptr[j0 + l] = std::isnan(Vp[l]) ? NA_REAL : Vp[l];
         }
+        return;
     }
 
-    /*
-     adjusting starting phenotypes if `sigma_V0 == 0`
-     */
-    if (Vp0.size() == 0) {
-        Vp0 = V0;
-        for (uint32_t j = 0; j < q; j++) {
-            if (sigma_V[j] > 0) {
-                for (uint32_t i = 0; i < n; i++) {
-                    Vp0[i][j] *= std::exp(distr(eng) * sigma_V[j]);
+    List get_list() {
+
+        const uint32_t n_ids = ids.size();
+        const uint32_t n_cols = n_ids + 3 + (pheno ? 1 : 0);
+        List out(n_cols);
+        CharacterVector names(n_cols);
+
+        for (uint32_t c = 0; c < n_ids; c++) {
+            if (id_levels[c] >= 0) {
+                int n_lvls = id_levels[c];
+                if (n_lvls == 0) {
+                    // (Only first of each `q` values needs checking)
+                    for (R_xlen_t j = 0; j < ids[c].size(); j += q) {
+                        if (id_ptrs[c][j] > n_lvls) n_lvls = id_ptrs[c][j];
+                    }
                 }
+                ids[c].attr("levels") = int_levels__(n_lvls);
+                ids[c].attr("class") = "factor";
             }
+            out[c] = ids[c];
+            names[c] = id_names[c];
         }
-    }
 
+        IntegerVector axis(N.size());
+        for (R_xlen_t j = 0; j < axis.size(); j++) axis[j] = j % q + 1;
+        axis.attr("levels") = int_levels__(q);
+        axis.attr("class") = "factor";
+
+        out[n_ids] = axis;
+        names[n_ids] = "axis";
+        out[n_ids + 1] = N;
+        names[n_ids + 1] = "N";
+        out[n_ids + 2] = geno;
+        names[n_ids + 2] = "geno";
+        if (pheno) {
+            out[n_ids + 3] = pheno_col;
+            names[n_ids + 3] = "pheno";
+        }
 
-    if (spp_gap_t == 0) {
-        info = OneRepInfo(N0, V0, Vp0, add_var);
-        N0.clear();
-        V0.clear();
-        Vp0.clear();
-        add_var.clear();
-    } else {
-        info = OneRepInfo(N0.front(), V0.front(), Vp0.front(), add_var.front());
-        N0.pop_front();
-        V0.pop_front();
-        Vp0.pop_front();
-        add_var.pop_front();
-    }
+        out.attr("names") = names;
+        out.attr("row.names") = IntegerVector::create(
+            NA_INTEGER, -static_cast<int>(N.size()));
+        out.attr("class") = CharacterVector::create("tbl_df", "tbl",
+                                                    "data.frame");
 
+        return out;
 
-    // Setting size for `info` fields
-    if (save_every > 0) {
-        uint32_t spp_add_saves = static_cast<uint32_t>(std::ceil(
-            static_cast<double>(spp_gap_t) / static_cast<double>(save_every)));
-        spp_add_saves += 2U;
-        uint32_t final_saves = static_cast<uint32_t>(std::ceil(
-            static_cast<double>(final_t) / static_cast<double>(save_every)));
-        final_saves += 2U;
-        info.reserve(final_saves + (info.n + V0.size() - 1) * spp_add_saves);
     }
 
-    uint32_t t = 0;
-    bool all_gone = false;
-    uint32_t interrupt_iters = 0;   // checking for user interrupt
-    uint32_t n_pb_incr = 0;         // progress bar increments
+private:
 
+    std::vector<std::string> id_names;
+    std::vector<int> id_levels;
+    uint32_t q;
+    bool pheno;
+    std::vector<IntegerVector> ids;
+    NumericVector N;
+    NumericVector geno;
+    NumericVector pheno_col;
+    std::vector<int*> id_ptrs;
+    double* N_ptr;
+    double* geno_ptr;
+    double* pheno_ptr;
 
-    // Save starting info:
-    if (save_every > 0) info.save_time(t);
+};
 
 
-    // First iterations with species additions
-    bool new_spp = false;
-    while (!N0.empty()) {
 
-        n_pb_incr++;
 
-        // Update abundances and traits:
-        all_gone = info.iterate(f, a0, C, r0, D, min_N,
-                                sigma_N, sigma_V, eng);
+#ifdef SAURON_ALTREP
 
-        // Add new species if necessary:
-        new_spp = (t + 1) == (info.n * spp_gap_t);
-        if (new_spp) {
-            info.add_species(N0.front(), V0.front(), Vp0.front(),
-                             add_var.front());
-            N0.pop_front();
-            V0.pop_front();
-            Vp0.pop_front();
-            add_var.pop_front();
-        }
-
-        if (save_every > 0 && (t % save_every == 0 || new_spp)) {
-            info.save_time(t + 1);
+/*
+ Output from all reps (see `RepOutput`), which lazy output columns read from.
+ All columns share it, and it's freed when the last of them is
+ garbage collected.
+ */
+class RepOutputs {
+public:
+
+    std::vector<RepOutput> reps;
+    std::vector<uint64_t> cum_rows;     // first wide row for each rep, then total
+    uint32_t q;
+    uint32_t n;
+    bool pheno;
+
+    RepOutputs(std::vector<RepOutput>&& reps_,
+               const uint32_t& q_,
+               const uint32_t& n_,
+               const bool& pheno_)
+        : reps(std::move(reps_)), cum_rows(reps.size() + 1, 0),
+          q(q_), n(n_), pheno(pheno_) {
+        for (uint32_t i = 0; i < reps.size(); i++) {
+            cum_rows[i+1] = cum_rows[i] + reps[i].n_rows();
         }
+    }
 
-        if (n_pb_incr > 100) {
-            prog_bar.increment(n_pb_incr);
-            n_pb_incr = 0;
-        }
+    inline uint64_t n_rows() const { return cum_rows.back(); }
 
-        t++;
+    // Rep that wide row `w` is in (skipping reps without rows):
+    inline uint64_t find_rep(const uint64_t& w) const {
+        return std::upper_bound(cum_rows.begin(), cum_rows.end(), w) -
+            cum_rows.begin() - 1;
+    }
 
+};
 
-        // Check for user interrupt:
-        if (interrupt_check(interrupt_iters, prog_bar, 100)) {
-            status = -1;
-            return;
-        }
 
-    }
+enum RepColumnType {rc_rep, rc_time, rc_spp, rc_axis, rc_N, rc_geno, rc_pheno};
 
-    if (final_t == 0) return;
+/*
+ One column of `quant_gen_cpp` output, with the same values as it would have
+ in `LongOutput`, but read from `RepOutputs` when R asks for them.
+ */
+class RepColumn : public lazy_col::LazyColumn {
+public:
 
-    uint32_t total_time = final_t + t;
+    std::shared_ptr<const RepOutputs> outs;
+    RepColumnType type;
 
-    // Final iterations with no species additions
-    while (!all_gone && t < total_time) {
+    RepColumn(const std::shared_ptr<const RepOutputs>& outs_,
+              const RepColumnType& type_)
+        : outs(outs_), type(type_) {}
 
-        n_pb_incr++;
+    R_xlen_t length() const {
+        return static_cast<R_xlen_t>(outs->n_rows() * outs->q);
+    }
+    void fill(R_xlen_t i, const R_xlen_t& n_, int* out) const {
+        fill_<int>(i, n_, out);
+    }
+    void fill(R_xlen_t i, const R_xlen_t& n_, double* out) const {
+        fill_<double>(i, n_, out);
+    }
 
-        // Update abundances and traits:
-        all_gone = info.iterate(f, a0, C, r0, D, min_N,
-                                sigma_N, sigma_V, eng);
+    std::string describe() const {
+        return "quant_gen output column " + std::to_string(type);
+    }
 
-        if (save_every > 0 &&
-            (t % save_every == 0 || (t+1) == final_t || all_gone)) {
-            info.save_time(t + 1);
+private:
+
+    // Fill `out` with values for long-format rows `[i, i + n_)`:
+    template <typename T>
+    void fill_(uint64_t i, const uint64_t& n_, T* out) const {
+        const RepOutputs& o(*outs);
+        if (n_ == 0) return;
+        uint64_t r = o.find_rep(i / o.q);
+        for (uint64_t j = 0; j < n_; j++, i++) {
+            const uint64_t w = i / o.q;
+            while (w >= o.cum_rows[r+1]) r++;
+            get(r, w - o.cum_rows[r], i % o.q, out[j]);
         }
+        return;
+    }
 
-        if (n_pb_incr > 100) {
-            prog_bar.increment(n_pb_incr);
-            n_pb_incr = 0;
+    inline void get(const uint64_t& r, const uint64_t& k, const uint32_t& axis,
+                    int& x) const {
+        const RepOutput& ro(outs->reps[r]);
+        if (type == rc_rep) {
+            x = r + 1;
+        } else if (type == rc_time) {
+            x = ro.time[k];
+        } else if (type == rc_spp) {
+            x = (ro.spp[k] < 1 || ro.spp[k] > outs->n) ?
+                NA_INTEGER : static_cast<int>(ro.spp[k]);
+        } else x = axis + 1;
+        return;
+    }
+    inline void get(const uint64_t& r, const uint64_t& k, const uint32_t& axis,
+                    double& x) const {
+        const RepOutput& ro(outs->reps[r]);
+        if (type == rc_N) {
+            x = ro.N[k];
+            return;
         }
+        // (Phenotypes are genotypes if they weren't kept)
+        x = (type == rc_pheno && outs->pheno) ?
+            ro.Vp[k * outs->q + axis] : ro.V[k * outs->q + axis];
+        if (std::isnan(x)) x = NA_REAL;
+        return;
+    }
 
-        t++;
+};
 
-        // Check for user interrupt:
-        if (interrupt_check(interrupt_iters, prog_bar, 100)) {
-            status = -1;
-            return;
-        }
+/*
+ Lazy version of `LongOutput::get_list`, which takes ownership of
+ `rep_outs` instead of copying them.
+ */
+List lazy_rep_output(std::vector<RepOutput>& rep_outs,
+                     const uint32_t& q,
+                     const uint32_t& n,
+                     const bool& pheno,
+                     const bool& through_time) {
+
+    std::shared_ptr<const RepOutputs> outs =
+        std::make_shared<const RepOutputs>(std::move(rep_outs), q, n, pheno);
+    const uint64_t n_out = outs->n_rows() * q;
+    if (n_out > static_cast<uint64_t>(INT_MAX)) {
+        stop("\nToo many rows (" + std::to_string(n_out) +
+            ") for one data frame; use `quant_gen_stream` instead");
+    }
 
+    // Rep levels go up to the last rep with any rows:
+    int max_rep = 0;
+    for (uint32_t i = 0; i < outs->reps.size(); i++) {
+        if (outs->reps[i].n_rows() > 0) max_rep = i + 1;
     }
 
-    if (n_pb_incr > 0) prog_bar.increment(n_pb_incr);
+    const uint32_t n_cols = (through_time ? 6 : 5) + (pheno ? 1 : 0);
+    List out(n_cols);
+    CharacterVector names(n_cols);
+    uint32_t j = 0;
+
+    // Add a column that's a factor if `n_lvls >= 0`:
+    auto add_col = [&](const std::string& name,
+                       const RepColumnType& type,
+                       const int& n_lvls) {
+        SEXP x = PROTECT(lazy_col::new_lazy_column(new RepColumn(outs, type),
+                                                   type < rc_N));
+        if (n_lvls >= 0) {
+            Rf_setAttrib(x, R_LevelsSymbol, int_levels__(n_lvls));
+            Rf_setAttrib(x, R_ClassSymbol, CharacterVector::create("factor"));
+        }
+        out[j] = x;
+        names[j] = name;
+        j++;
+        UNPROTECT(1);
+        return;
+    };
+
+    add_col("rep", rc_rep, max_rep);
+    if (through_time) add_col("time", rc_time, -1);
+    add_col("spp", rc_spp, n);
+    add_col("axis", rc_axis, q);
+    add_col("N", rc_N, -1);
+    add_col("geno", rc_geno, -1);
+    if (pheno) add_col("pheno", rc_pheno, -1);
+
+    out.attr("names") = names;
+    out.attr("row.names") = IntegerVector::create(
+        NA_INTEGER, -static_cast<int>(n_out));
+    out.attr("class") = CharacterVector::create("tbl_df", "tbl",
+                                                "data.frame");
+
+    return out;
 
-    return;
 }
 
+#endif
+
+
+
 
 //' Multiple repetitions of quantitative genetics.
 //'
+//' Returns a list with `nv` (N and V output as a long-format tibble; see
+//' `LongOutput`), `rep_copies`, and `seeds`.
+//' When there's no stochasticity, all reps are identical, so only one is
+//' simulated and `rep_copies` is set to `n_reps` (it's 1 otherwise).
+//' `seeds` contains the raw seeds used for each simulated rep (one column
+//' per rep).
+//' Passing a subset of its columns as `raw_seeds` replays those reps exactly,
+//' in which case `n_reps` is ignored.
+//' If `raw_seeds` has no columns, new seeds are drawn.
+//'
+//' If `max_secs > 0`, reps stop after that many seconds of wall-clock time.
+//' When this happens (or the user interrupts and `stop_gracefully` is `true`),
+//' only reps that finished are included in `nv`,
+//' and the `completed` item in the output indicates which reps these are.
 //'
 //' @noRd
 //'
 //[[Rcpp::export]]
-arma::mat quant_gen_cpp(const uint32_t& n_reps,
-                        const std::deque<arma::vec>& V0,
-                        const std::deque<arma::vec>& Vp0,
-                        const std::deque<double>& N0,
-                        const double& f,
-                        const double& a0,
-                        const arma::mat& C,
-                        const double& r0,
-                        const arma::mat& D,
-                        const std::deque<double>& add_var,
-                        const double& sigma_V0,
-                        const double& sigma_N,
-                        const std::vector<double>& sigma_V,
-                        const uint32_t& spp_gap_t,
-                        const uint32_t& final_t,
-                        const double& min_N,
-                        const uint32_t& save_every,
-                        const bool& show_progress,
-                        const uint32_t& n_threads) {
+List quant_gen_cpp(const uint32_t& n_reps,
+                   const std::deque<arma::vec>& V0,
+                   const std::deque<arma::vec>& Vp0,
+                   const std::deque<double>& N0,
+                   const double& f,
+                   const double& a0,
+                   const arma::mat& C,
+                   const double& r0,
+                   const arma::mat& D,
+                   const std::deque<double>& add_var,
+                   const double& sigma_V0,
+                   const double& sigma_N,
+                   const std::vector<double>& sigma_V,
+                   const uint32_t& spp_gap_t,
+                   const uint32_t& final_t,
+                   const double& min_N,
+                   const uint32_t& save_every,
+                   const arma::mat& raw_seeds,
+                   const double& max_secs,
+                   const bool& stop_gracefully,
+                   const bool& show_progress,
+                   const uint32_t& n_threads) {
 
     if (!C.is_symmetric()) stop("C must be symmetric");
     if (!D.is_symmetric()) stop("D must be symmetric");
@@ -1133,47 +1534,77 @@ arma::mat quant_gen_cpp(const uint32_t& n_reps,
     if (D.n_cols != q) stop("D.n_cols != q");
     if (D.n_rows != q) stop("D.n_rows != q");
 
-    std::vector<OneRepInfo> rep_infos(n_reps);
+    /*
+     Without stochasticity in starting values, abundances, or phenotypes,
+     every rep gives the same output, so just simulate one.
+     */
+    bool deterministic = sigma_V0 <= 0 && sigma_N <= 0;
+    for (const double& sv : sigma_V) deterministic = deterministic && sv <= 0;
+    const uint32_t n_reps_ = raw_seeds.n_cols > 0 ? raw_seeds.n_cols : n_reps;
+    const uint32_t n_sims = deterministic ? 1U : n_reps_;
 
-    const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_reps);
+    bool pheno = false;
+    for (const double& sv : sigma_V) pheno = pheno || sv > 0;
+    const bool through_time = save_every > 0;
 
-    Progress prog_bar(n_reps * (final_t + (n - 1) * spp_gap_t), show_progress);
-    bool interrupted = false;
+    /*
+     Output from each rep, made as soon as it's finished.
+     These are what output columns read from (see `RepOutput`).
+     */
+    std::vector<RepOutput> rep_outs(n_sims);
+
+    // Keeping raw seeds so that reps can be replayed:
+    const arma::mat raw_seeds_ = raw_seeds.n_cols > 0 ?
+        arma::mat(raw_seeds.cols(0, n_sims - 1)) : mc_raw_seeds_rep(n_sims);
+    const std::vector<std::vector<uint128_t>> seeds = seeds_from_raw(raw_seeds_);
+
+    Progress prog_bar(n_sims * (final_t + (n - 1) * spp_gap_t), show_progress);
+
+    // Wall-clock limit (if any):
+    typedef DeadlineProgress<Progress>::clock clock;
+    const bool has_deadline = max_secs > 0 && std::isfinite(max_secs);
+    clock::time_point deadline = clock::now();
+    if (has_deadline) {
+        deadline += std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(max_secs));
+    }
+    // Not using std::vector<bool> bc threads write to it:
+    std::vector<int> completed(n_sims, 0);
 
     #ifdef _OPENMP
     #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
     {
     #endif
 
-
-    #ifdef _OPENMP
-    uint32_t active_thread = omp_get_thread_num();
-    #else
-    uint32_t active_thread = 0;
-    #endif
-
     int status = 0;
 
     pcg64 eng;
 
+    DeadlineProgress<Progress> dl_prog_bar(prog_bar, has_deadline, deadline);
+
     #ifdef _OPENMP
     #pragma omp for schedule(static)
     #endif
-    for (uint32_t i = 0; i < n_reps; i++) {
+    for (uint32_t i = 0; i < n_sims; i++) {
+        // (Freed at the end of each iteration)
+        OneRepInfo info;
         eng.seed(seeds[i][0], seeds[i][1]);
         one_quant_gen__(status,
-                        rep_infos[i], V0, Vp0, N0, f, a0, C, r0, D,
+                        info, V0, Vp0, N0, f, a0, C, r0, D,
                         add_var, sigma_V0, sigma_N, sigma_V,
                         spp_gap_t, final_t, min_N,
-                        save_every, eng, prog_bar);
-
-        if (active_thread == 0 && status != 0) interrupted = true;
+                        save_every, eng, dl_prog_bar);
+        // Reps stopped early always have `status != 0`:
+        if (status == 0) {
+            completed[i] = 1;
+            rep_outs[i] = RepOutput(info, q, through_time, pheno);
+        }
     }
     #ifdef _OPENMP
     }
     #endif
 
-    if (interrupted) {
+    if (prog_bar.is_aborted() && !stop_gracefully) {
         throw(Rcpp::exception("\nUser interrupted process.", false));
     }
 
@@ -1182,94 +1613,148 @@ arma::mat quant_gen_cpp(const uint32_t& n_reps,
      Now organize output:
      ------------
      */
-    arma::mat nv; // N and V - either through time or just final values
-
     /*
-     Go through one time to calculate the # surviving species for all reps and
-     for all time point(s) saved.
-     Then go back through and fill in values.
+     Output is long-format, typed columns (see `LongOutput`), either through
+     time or just final values.
+     Where R supports it, columns are lazy and read straight from `rep_outs`,
+     so output is only stored once.
+     Otherwise, calculate the cumulative # rows for all reps, then fill in
+     values, with each thread copying whole reps starting at their row
+     offsets and freeing each rep's output once it's copied.
      */
-    uint32_t total_n_spp = 0;
-    if (save_every > 0) {  //   ---- Saving values through time: ----
+#ifdef SAURON_ALTREP
 
-        for (uint32_t i = 0; i < n_reps; i++) {
-            for (uint32_t j = 0; j < rep_infos[i].t.size(); j++) {
-                total_n_spp += rep_infos[i].N_t[j].size();
-            }
+    List nv_list = lazy_rep_output(rep_outs, q, n, pheno, through_time);
+
+#else
+
+    std::vector<uint64_t> cum_rows(n_sims + 1, 0);
+    for (uint32_t i = 0; i < n_sims; i++) {
+        cum_rows[i+1] = cum_rows[i] + rep_outs[i].n_rows();
+    }
+    std::vector<std::string> id_names;
+    std::vector<int> id_levels;
+    if (through_time) {
+        id_names = {"rep", "time", "spp"};
+        id_levels = {0, -1, static_cast<int>(n)};
+    } else {
+        id_names = {"rep", "spp"};
+        id_levels = {0, static_cast<int>(n)};
+    }
+    LongOutput nv(id_names, id_levels, q, pheno, cum_rows.back());
+
+    #ifdef _OPENMP
+    #pragma omp parallel for default(shared) num_threads(n_threads) schedule(dynamic)
+    #endif
+    for (uint32_t i = 0; i < n_sims; i++) {
+
+        const RepOutput& ro(rep_outs[i]);
+        uint64_t j = cum_rows[i];
+
+        for (uint64_t k = 0; k < ro.n_rows(); k++, j++) {
+            const double* V_k = &ro.V[k * q];
+            const double* Vp_k = pheno ? &ro.Vp[k * q] : V_k;
+            nv.set_id(j, 0, i + 1);                 // rep
+            if (through_time) {
+                nv.set_id(j, 1, ro.time[k]);        // time
+                nv.set_id(j, 2, ro.spp[k]);         // species
+            } else nv.set_id(j, 1, ro.spp[k]);      // species
+            nv.set_values(j, ro.N[k], V_k, Vp_k);
         }
-        nv.set_size(total_n_spp, 4 + 2 * q);
-
-        uint32_t j = 0;
-        for (uint32_t i = 0; i < n_reps; i++) {
-
-            Rcpp::checkUserInterrupt();
-            const OneRepInfo& info(rep_infos[i]);
-            for (uint32_t t = 0; t < info.t.size(); t++) {
-
-                const std::vector<double>& N_t(info.N_t[t]);
-                const std::vector<arma::vec>& V_t(info.V_t[t]);
-                const std::vector<arma::vec>& Vp_t(info.Vp_t[t]);
-                const std::vector<uint32_t>& spp_t(info.spp_t[t]);
-                const double& t_(info.t[t]);
-                for (uint32_t k = 0; k < N_t.size(); k++) {
-
-                    nv(j+k,0) = i + 1;      // rep
-                    nv(j+k,1) = t_;         // time
-                    nv(j+k,2) = spp_t[k];   // species
-                    nv(j+k,3) = N_t[k];     // N
-                    // V and Vp:
-                    for (uint32_t l = 0; l < q; l++) {
-                        nv(j+k, 4+l) = V_t[k](l);       // V
-                        nv(j+k, 4+q+l) = Vp_t[k](l);    //  Vp
-                    }
 
-                }
+        rep_outs[i] = RepOutput();
+
+    }
 
-                j += N_t.size();
+    List nv_list = nv.get_list();
 
-            }
+#endif
 
-        }
+    const int rep_copies = deterministic ? static_cast<int>(n_reps_) : 1;
+    List out = List::create(_["nv"] = nv_list,
+                            _["rep_copies"] = rep_copies,
+                            _["seeds"] = raw_seeds_,
+                            _["completed"] = LogicalVector(completed.begin(),
+                                                           completed.end()));
 
-    } else {  //                ----  Just saving final values:  ----
+    return out;
 
-        for (uint32_t i = 0; i < n_reps; i++) {
-            total_n_spp += rep_infos[i].N.size();
-            if (rep_infos[i].N.empty()) total_n_spp++;
-        }
-        nv.set_size(total_n_spp, 3 + 2 * q);
-        uint32_t j = 0;
-        for (uint32_t i = 0; i < n_reps; i++) {
-            Rcpp::checkUserInterrupt();
-            const OneRepInfo& info(rep_infos[i]);
-            if (!info.N.empty()) {
-                for (uint32_t k = 0; k < info.N.size(); k++) {
-                    nv(j+k,0) = i + 1;          // rep
-                    nv(j+k,1) = info.spp[k];    // species
-                    nv(j+k,2) = info.N[k];      // N
-                    // V and Vp:
-                    for (uint32_t l = 0; l < q; l++) {
-                        nv(j+k, 3+l) = info.V[k](l);
-                        nv(j+k, 3+q+l) = info.Vp[k](l);
-                    }
-                }
-                j += info.N.size();
-            } else {
-                nv(j,0) = i + 1;      // rep
-                nv(j,1) = 0;          // species
-                nv(j,2) = 0;          // N
-                // V and Vp:
-                for (uint32_t l = 0; l < q; l++) {
-                    nv(j, 3+l) = arma::datum::nan;
-                    nv(j, 3+q+l) = arma::datum::nan;
-                }
-                j++;
-            }
+}
+
+
+
+
+
+//' Long-format output from a wide output matrix.
+//'
+//' `wide` has `id_names.size()` ID columns (e.g., rep, time, and species),
+//' then abundance, `q` genotype columns, and `q` phenotype columns.
+//' This returns a tibble with one row per row in `wide` and axis,
+//' sorted by the ID columns then axis (see `LongOutput` for its columns).
+//' Values outside a factor's levels are sorted last.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List long_output_cpp(const arma::mat& wide,
+                     const std::vector<std::string>& id_names,
+                     const std::vector<int>& id_levels,
+                     const uint32_t& q,
+                     const bool& pheno) {
+
+    const uint32_t n_ids = id_names.size();
+    if (wide.n_cols != n_ids + 1 + 2 * q) stop("wide.n_cols is incorrect");
+
+    const uint32_t n_wide = wide.n_rows;
+
+    std::vector<int> levels(id_levels);
+    for (uint32_t c = 0; c < n_ids && c < levels.size(); c++) {
+        if (levels[c] != 0) continue;
+        double max_id = 0;
+        for (uint32_t i = 0; i < n_wide; i++) {
+            if (wide(i, c) > max_id) max_id = wide(i, c);
         }
+        levels[c] = static_cast<int>(max_id);
+    }
 
+    // ID values for sorting, where values outside factor levels go last:
+    auto id_key = [&](const uint32_t& i, const uint32_t& c) {
+        const double& x(wide(i, c));
+        if (levels[c] > 0 && (x < 1 || x > levels[c])) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return x;
+    };
+    auto id_less = [&](const uint32_t& i, const uint32_t& j) {
+        for (uint32_t c = 0; c < n_ids; c++) {
+            const double ki = id_key(i, c);
+            const double kj = id_key(j, c);
+            if (ki != kj) return ki < kj;
+        }
+        return false;
+    };
+
+    // Rows are usually already sorted, so only sort if they aren't:
+    std::vector<uint32_t> order(n_wide);
+    std::iota(order.begin(), order.end(), 0U);
+    bool sorted = true;
+    for (uint32_t i = 1; i < n_wide && sorted; i++) {
+        sorted = !id_less(i, i - 1);
+    }
+    if (!sorted) std::stable_sort(order.begin(), order.end(), id_less);
+
+    LongOutput out(id_names, id_levels, q, pheno, n_wide);
+    std::vector<double> V(q), Vp(q);
+    for (uint32_t j = 0; j < n_wide; j++) {
+        const uint32_t& i(order[j]);
+        for (uint32_t c = 0; c < n_ids; c++) out.set_id(j, c, wide(i, c));
+        for (uint32_t l = 0; l < q; l++) {
+            V[l] = wide(i, n_ids + 1 + l);
+            Vp[l] = wide(i, n_ids + 1 + q + l);
+        }
+        out.set_values(j, wide(i, n_ids), V, Vp);
     }
 
-    return nv;
+    return out.get_list();
 
 }
-
@@ -4,7 +4,9 @@
 
 #include <RcppArmadillo.h>
 #include <random>
+#include <deque>
 #include "sim.hpp"
+#include "traj_io.hpp"
 
 using namespace Rcpp;
 
@@ -21,6 +23,193 @@ void sel_str__(arma::mat& ss_mat,
                const double& r0,
                const arma::mat& D);
 
+arma::mat jacobian_cpp(const arma::mat& V,
+                       const std::vector<double>& N,
+                       const double& f,
+                       const double& a0,
+                       const double& r0,
+                       const arma::mat& D,
+                       const arma::mat& C,
+                       const arma::vec& add_var,
+                       const bool& evo_only);
+
+void step_jacobian__(arma::mat& jcb_mat,
+                     arma::mat& dV_dN1,
+                     const std::vector<arma::vec>& V,
+                     const std::vector<arma::vec>& Vp,
+                     const std::vector<double>& N,
+                     const std::vector<double>& N1,
+                     const std::vector<double>& add_var,
+                     const arma::mat& ss_mat,
+                     const double& f,
+                     const double& a0,
+                     const arma::mat& C,
+                     const double& r0,
+                     const arma::mat& D);
+
+void sens_step__(std::vector<arma::mat>& sens,
+                 const std::vector<arma::vec>& V,
+                 const std::vector<arma::vec>& Vp,
+                 const std::vector<double>& N,
+                 const std::vector<double>& N1,
+                 const std::vector<double>& add_var,
+                 const arma::mat& ss_mat,
+                 const double& f,
+                 const double& a0,
+                 const arma::mat& C,
+                 const double& r0,
+                 const arma::mat& D,
+                 const arma::mat& dC,
+                 const arma::mat& dD);
+
+/*
+ Noise stream for one species.
+ These are used instead of a rep's single RNG when noise should line up
+ among reps (see `NoiseOptions` below).
+ Each species' stream is the rep's RNG advanced by a multiple of 2^64,
+ so streams for different species never overlap.
+ */
+struct SppNoise {
+    pcg64 eng;
+    normal_distr distr;
+    double sign;            // -1 for antithetic reps
+
+    SppNoise() : eng(), distr(0, 1), sign(1) {};
+    SppNoise(const pcg64& eng_, const uint32_t& idx, const bool& antithetic)
+        : eng(eng_), distr(0, 1), sign(antithetic ? -1 : 1) {
+        eng.advance(static_cast<uint128_t>(idx + 1) << 64);
+    };
+
+    // Standard normal deviate:
+    inline double norm() {
+        return sign * distr(eng);
+    }
+    // Uniform deviate in (0,1):
+    inline double unif() {
+        double u = runif_01(eng);
+        if (sign < 0) u = 1 - u;
+        return u;
+    }
+};
+
+/*
+ Options for how noise is generated in `one_quant_gen__`.
+
+ If `by_species` is true, each species gets its own noise stream (`SppNoise`)
+ and draws from it every time step whether or not it's used.
+ Reps with the same seed then see the same sequence of abundance and
+ phenotype shocks for each species, even when parameters differ.
+ If `antithetic` is also true, all shocks are negated.
+ */
+struct NoiseOptions {
+    bool by_species;
+    bool antithetic;
+
+    NoiseOptions() : by_species(false), antithetic(false) {};
+    NoiseOptions(const bool& by_species_, const bool& antithetic_)
+        : by_species(by_species_ || antithetic_), antithetic(antithetic_) {};
+};
+
+/*
+ Options for tangent-linear quantities in `one_quant_gen__`.
+
+ If `sens` is true, sensitivities of all species' traits and abundances
+ to `f`, `a0`, `r0`, `eta`, and `d` are updated every time step
+ (see `sens_step__` in `quant_gen.cpp`).
+ `dC` and `dD` are the derivatives of `C` and `D` with respect to
+ `eta` and `d`.
+ These are only correct without stochasticity in abundances or phenotypes.
+
+ If `n_lyap > 0`, the leading `n_lyap` finite-time Lyapunov exponents are
+ found from QR-orthonormalized products of one-step Jacobians
+ (see `step_jacobian__` in `quant_gen.cpp`) and saved with other output.
+ */
+struct TangentOptions {
+    bool sens;
+    arma::mat dC;
+    arma::mat dD;
+    uint32_t n_lyap;
+
+    TangentOptions() : sens(false), dC(), dD(), n_lyap(0) {};
+    TangentOptions(const arma::mat& dC_, const arma::mat& dD_)
+        : sens(true), dC(dC_), dD(dD_), n_lyap(0) {};
+    TangentOptions(const uint32_t& n_lyap_)
+        : sens(false), dC(), dD(), n_lyap(n_lyap_) {};
+};
+
+
+/*
+ Online mean and variance (Welford's algorithm).
+ */
+struct Welford {
+    double n;
+    double mean;
+    double m2;
+
+    Welford() : n(0), mean(0), m2(0) {};
+
+    inline void add(const double& x) {
+        n++;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+        return;
+    }
+    inline double var() const {
+        if (n < 2) return arma::datum::nan;
+        return m2 / (n - 1);
+    }
+};
+
+/*
+ Summary of one species in one rep: when it was added and went extinct
+ (`NaN` if never), the last time it was present, and means and variances
+ of its abundance and genotypes over the final window.
+ */
+struct SppSummary {
+    double added;
+    double extinct;
+    double last_seen;
+    Welford N;
+    std::vector<Welford> V;
+
+    SppSummary() : added(arma::datum::nan), extinct(arma::datum::nan),
+        last_seen(arma::datum::nan), N(), V() {};
+    SppSummary(const uint32_t& q) : added(arma::datum::nan),
+        extinct(arma::datum::nan), last_seen(arma::datum::nan), N(), V(q) {};
+};
+
+/*
+ Options for summary-only output in `one_quant_gen__`.
+
+ If `track` is true, species summaries (see `SppSummary`) are updated every
+ time step, where the final window is the last `window` time steps.
+ */
+struct SummaryOptions {
+    bool track;
+    uint32_t window;
+
+    SummaryOptions() : track(false), window(0) {};
+    SummaryOptions(const uint32_t& window_) : track(true), window(window_) {};
+};
+
+/*
+ Options for streaming output in `one_quant_gen__`.
+
+ If `buf` isn't null, saved times are written to it (as rep `rep`)
+ instead of being kept in `OneRepInfo`, so memory use doesn't grow with the
+ number of saved times (see `traj_io.hpp`).
+ */
+struct StreamOptions {
+    TrajBuffer* buf;
+    uint32_t rep;
+
+    StreamOptions() : buf(nullptr), rep(0) {};
+    StreamOptions(TrajBuffer* buf_, const uint32_t& rep_)
+        : buf(buf_), rep(rep_) {};
+};
+
+
 /*
  Output info for one repetition:
  */
@@ -39,6 +228,21 @@ public:
     std::vector<std::vector<arma::vec>> V_t;
     std::vector<std::vector<arma::vec>> Vp_t;
     std::vector<std::vector<uint32_t>> spp_t;
+    /*
+     Sensitivities of traits (first q rows) and abundance (last row) to
+     `f`, `a0`, `r0`, `eta`, and `d` (columns), one matrix per species.
+     Empty unless using `track_tangent` with sensitivities.
+     */
+    std::vector<arma::mat> sens;
+    /*
+     Finite-time Lyapunov exponents at saved times, and the number of
+     time steps they're averaged over (since species last changed).
+     Empty unless using `track_tangent` with Lyapunov exponents.
+     */
+    std::vector<arma::vec> lyap_t;
+    std::vector<uint32_t> lyap_steps_t;
+    // Species summaries (empty unless using `start_summary`):
+    std::vector<SppSummary> summ;
 
     OneRepInfo () {};
     OneRepInfo(const std::deque<double>& N_,
@@ -121,12 +325,18 @@ public:
         // Setting up vector of extinct clones (if any):
         std::vector<uint32_t> extinct;
         extinct.reserve(current_n);
+        // Abundances before updating, for tangent-linear quantities:
+        if (tan_opts.sens || tan_opts.n_lyap > 0) N_last = N;
         // Fill in density dependences:
         A_VN_<std::vector<double>>(A, Vp, N, a0, D);
         // Fill in abundances:
         for (uint32_t i = 0; i < current_n; i++) {
             double r = r_V_<arma::vec>(Vp[i], f, C, r0);
-            if (sigma_N <= 0) {
+            if (!spp_noise.empty()) {
+                // Always drawn so that noise streams stay lined up:
+                double z = spp_noise[spp[i]-1].norm();
+                N[i] *= std::exp(r - A[i] + z * sigma_N);
+            } else if (sigma_N <= 0) {
                 N[i] *= std::exp(r - A[i]);
             } else N[i] *= std::exp(r - A[i] + rand_norm(eng) * sigma_N);
             // See if it goes extinct:
@@ -145,6 +355,13 @@ public:
         // Fill in selection-strength matrix:
         sel_str__(ss_mat, Vp, N, f, a0, C, r0, D);
 
+        // Tangent-linear quantities use traits before they're changed:
+        if (tan_opts.sens) {
+            sens_step__(sens, V, Vp, N_last, N, add_var, ss_mat, f, a0, C,
+                        r0, D, tan_opts.dC, tan_opts.dD);
+        }
+        if (tan_opts.n_lyap > 0) lyap_step(f, a0, C, r0, D);
+
         /*
          Then include additive genetic variance when adding to trait values.
          Also add stochasticity to phenotypes if necessary.
@@ -176,15 +393,19 @@ public:
         n++;
         spp.push_back(n);
         A.push_back(0);
+        if (tan_opts.sens) {
+            sens.push_back(arma::mat(q + 1, 5, arma::fill::zeros));
+        }
 
         return;
     }
 
     // save info for output
     void save_time(const uint32_t& t_) {
-        t.push_back(t_);
-        // If everything's extinct...
-        if (N.size() == 0) {
+        if (stream_opts.buf != nullptr) {
+            stream_time(t_);
+        } else if (N.size() == 0) {  // If everything's extinct...
+            t.push_back(t_);
             // Fill last set of N's with a zero:
             N_t.push_back(std::vector<double>(1, 0.0));
             // Fill last V and Vp with a `NaN` (closest to NA I know of):
@@ -195,16 +416,92 @@ public:
             // Fill last set of spp's with a zero:
             spp_t.push_back(std::vector<uint32_t>(1, 0U));
         } else {
+            t.push_back(t_);
             N_t.push_back(N);
             V_t.push_back(V);
             Vp_t.push_back(Vp);
             spp_t.push_back(spp);
         }
+        if (tan_opts.n_lyap > 0) {
+            arma::vec lyap(tan_opts.n_lyap);
+            lyap.fill(arma::datum::nan);
+            if (lyap_steps > 0 && N.size() > 0) {
+                for (uint32_t k = 0; k < lyap_sum.n_elem; k++) {
+                    lyap(k) = lyap_sum(k) / static_cast<double>(lyap_steps);
+                }
+            }
+            lyap_t.push_back(lyap);
+            lyap_steps_t.push_back(lyap_steps);
+        }
+        return;
+    }
+
+
+    /*
+     Use separate noise streams for each species.
+     `spp_noise_` should have one item per species that will be added,
+     in the same order as species indexes.
+     */
+    void set_spp_noise(const std::vector<SppNoise>& spp_noise_) {
+        spp_noise = spp_noise_;
+        return;
+    }
+
+
+    /*
+     Track tangent-linear quantities (see `TangentOptions`).
+     Starting values don't depend on parameters, so sensitivities start
+     at zero.
+     */
+    void track_tangent(const TangentOptions& tan_opts_) {
+        tan_opts = tan_opts_;
+        if (tan_opts.sens) {
+            sens.assign(N.size(), arma::mat(q + 1, 5, arma::fill::zeros));
+        }
+        lyap_spp.clear();
+        return;
+    }
+
+
+    // Write saved times to a buffer instead of keeping them:
+    void stream_to(const StreamOptions& stream_opts_) {
+        stream_opts = stream_opts_;
+        return;
+    }
+
+
+    // Start summaries for `n_total` species (including ones added later):
+    void start_summary(const uint32_t& n_total) {
+        summ.assign(n_total, SppSummary(q));
+        return;
+    }
+
+    /*
+     Update species summaries at time `t_`.
+     Species that were present before but aren't now went extinct at `t_`.
+     */
+    void update_summary(const double& t_, const bool& in_window) {
+        for (uint32_t i = 0; i < spp.size(); i++) {
+            SppSummary& s(summ[spp[i]-1]);
+            if (std::isnan(s.added)) s.added = t_;
+            s.last_seen = t_;
+            if (in_window) {
+                s.N.add(N[i]);
+                for (uint32_t j = 0; j < q; j++) s.V[j].add(V[i](j));
+            }
+        }
+        for (SppSummary& s : summ) {
+            if (!std::isnan(s.added) && std::isnan(s.extinct) &&
+                s.last_seen < t_) {
+                s.extinct = t_;
+            }
+        }
         return;
     }
 
 
     void reserve(const uint32_t& n_saves) {
+        if (stream_opts.buf != nullptr) return;
         t.reserve(n_saves);
         N_t.reserve(n_saves);
         V_t.reserve(n_saves);
@@ -214,16 +511,161 @@ public:
     }
 
 
+    // How many rows is required for this repetition?
+    uint32_t n_rows(const bool& through_time) const {
+        uint32_t nr = 0;
+        if (through_time) {
+            for (const std::vector<double>& nn : N_t) nr += nn.size();
+        } else {
+            nr = N.size();
+            if (nr == 0) nr++; // row of NaNs if everything's extinct
+        }
+        return nr;
+    }
+
+
+    /*
+     Fill a matrix with data from this rep.
+     The first columns are filled with `ids` (e.g., rep number), and the
+     remaining columns are as follows:
+       time           (only if `through_time` is true)
+       species
+       abundance
+       genotypes      (q columns)
+       phenotypes     (q columns)
+     */
+    void fill_matrix(arma::mat& matrix,
+                     const std::vector<double>& ids,
+                     uint32_t start_row,
+                     const bool& through_time) const {
+
+        uint32_t c0 = ids.size();
+
+        if (through_time) {
+
+            for (uint32_t i = 0; i < t.size(); i++) {
+
+                const std::vector<double>& N_(N_t[i]);
+                const std::vector<arma::vec>& V_(V_t[i]);
+                const std::vector<arma::vec>& Vp_(Vp_t[i]);
+                const std::vector<uint32_t>& spp_(spp_t[i]);
+
+                for (uint32_t k = 0; k < N_.size(); k++) {
+                    uint32_t r = start_row + k;
+                    for (uint32_t l = 0; l < c0; l++) matrix(r, l) = ids[l];
+                    matrix(r, c0) = t[i];
+                    matrix(r, c0+1) = spp_[k];
+                    matrix(r, c0+2) = N_[k];
+                    for (uint32_t l = 0; l < q; l++) {
+                        matrix(r, c0+3+l) = V_[k](l);
+                        matrix(r, c0+3+q+l) = Vp_[k](l);
+                    }
+                }
+
+                start_row += N_.size();
+
+            }
+
+        } else if (!N.empty()) {
+
+            for (uint32_t k = 0; k < N.size(); k++) {
+                uint32_t r = start_row + k;
+                for (uint32_t l = 0; l < c0; l++) matrix(r, l) = ids[l];
+                matrix(r, c0) = spp[k];
+                matrix(r, c0+1) = N[k];
+                for (uint32_t l = 0; l < q; l++) {
+                    matrix(r, c0+2+l) = V[k](l);
+                    matrix(r, c0+2+q+l) = Vp[k](l);
+                }
+            }
+
+        } else {
+
+            for (uint32_t l = 0; l < c0; l++) matrix(start_row, l) = ids[l];
+            matrix(start_row, c0) = 0;      // species
+            matrix(start_row, c0+1) = 0;    // N
+            for (uint32_t l = 0; l < q; l++) {
+                matrix(start_row, c0+2+l) = arma::datum::nan;
+                matrix(start_row, c0+2+q+l) = arma::datum::nan;
+            }
+
+        }
+
+        return;
+    }
+
+
 private:
 
     std::vector<double> A;  // Density dependence
     arma::mat ss_mat;       // Selection strength
     uint32_t q;             // # traits
     normal_distr rand_norm = normal_distr(0, 1);
+    std::vector<SppNoise> spp_noise;    // empty unless using `set_spp_noise`
+    TangentOptions tan_opts;            // see `track_tangent`
+    std::vector<double> N_last;         // abundances before update
+    // For Lyapunov exponents:
+    arma::mat lyap_Q;                   // orthonormal tangent vectors
+    arma::vec lyap_sum;                 // sums of log stretching factors
+    uint32_t lyap_steps = 0;            // time steps in sums
+    std::vector<uint32_t> lyap_spp;     // species when tangent vectors started
+    StreamOptions stream_opts;          // see `stream_to`
+
+
+    // Write one saved time to the stream buffer:
+    inline void stream_time(const uint32_t& t_) {
+        if (N.size() == 0) {
+            // Same as in `save_time`: zeros for N and species, NaN for traits
+            arma::vec V__(q);
+            V__.fill(arma::datum::nan);
+            stream_opts.buf->add(stream_opts.rep, t_, 0U, 0.0, V__, V__);
+        } else {
+            for (uint32_t i = 0; i < N.size(); i++) {
+                stream_opts.buf->add(stream_opts.rep, t_, spp[i], N[i],
+                                     V[i], Vp[i]);
+            }
+        }
+        return;
+    }
 
 
+    /*
+     Multiply tangent vectors by the Jacobian for one time step and
+     re-orthonormalize them, adding log stretching factors to the sums.
+     Tangent vectors restart whenever species change, since that changes
+     the dimension of the system.
+     */
+    inline void lyap_step(const double& f,
+                          const double& a0,
+                          const arma::mat& C,
+                          const double& r0,
+                          const arma::mat& D) {
+        if (spp != lyap_spp) {
+            const uint32_t m = V.size() * (q + 1);
+            const uint32_t k = std::min(tan_opts.n_lyap, m);
+            lyap_spp = spp;
+            lyap_Q = arma::eye<arma::mat>(m, k);
+            lyap_sum.zeros(k);
+            lyap_steps = 0;
+        }
+        arma::mat jcb_mat;
+        arma::mat dV_dN1;
+        step_jacobian__(jcb_mat, dV_dN1, V, Vp, N_last, N, add_var, ss_mat,
+                        f, a0, C, r0, D);
+        const arma::mat JQ = jcb_mat * lyap_Q;
+        arma::mat R;
+        arma::qr_econ(lyap_Q, R, JQ);
+        lyap_sum += arma::log(arma::abs(R.diag()));
+        lyap_steps++;
+        return;
+    }
+
     inline void change_V(const std::vector<double>& sigma_V,
                          pcg64& eng) {
+        if (!spp_noise.empty()) {
+            change_V_spp_noise(sigma_V);
+            return;
+        }
         for (uint32_t j = 0; j < q; j++) {
             if (sigma_V[j] > 0) {
                 change_V_lnorm(sigma_V, j, eng);
@@ -247,6 +689,19 @@ private:
         return;
     }
 
+    inline void change_V_spp_noise(const std::vector<double>& sigma_V) {
+        for (uint32_t i = 0; i < V.size(); i++) {
+            SppNoise& noise(spp_noise[spp[i]-1]);
+            for (uint32_t j = 0; j < q; j++) {
+                V[i][j] += (add_var[i] * ss_mat(j,i));
+                if (V[i][j] < 0) V[i][j] = 0; // <-- keeping traits >= 0
+                // Always drawn so that noise streams stay lined up:
+                Vp[i][j] = V[i][j] * std::exp(noise.norm() * sigma_V[j]);
+            }
+        }
+        return;
+    }
+
     inline void change_V_determ(const uint32_t& j) {
         for (uint32_t i = 0; i < V.size(); i++) {
             V[i][j] += (add_var[i] * ss_mat(j,i));
@@ -265,6 +720,7 @@ private:
         add_var.erase(add_var.begin() + idx);
         A.erase(A.begin() + idx);
         spp.erase(spp.begin() + idx);
+        if (!sens.empty()) sens.erase(sens.begin() + idx);
 
         return;
 
@@ -279,6 +735,7 @@ private:
         add_var.clear();
         A.clear();
         spp.clear();
+        sens.clear();
 
         return;
 
@@ -290,6 +747,335 @@ private:
 
 
 
+/*
+ Compact output from one finished rep, with one row per species and saved
+ time (or per species at the end), and traits stored contiguously
+ (`q` values per row).
+ This is made from a `OneRepInfo` by the thread that finished the rep, so
+ the `OneRepInfo` (with its many small vectors) can be freed right away
+ instead of being kept until all reps are done.
+ These are also where output is finally stored: `quant_gen_cpp` returns
+ lazy columns that read from them (see `RepColumn` in `quant_gen.cpp`),
+ so peak memory is the reps in progress plus one compact copy of output.
+ For runs whose output doesn't fit in memory, use `quant_gen_stream`.
+ */
+class RepOutput {
+public:
+
+    std::vector<uint32_t> time;     // (empty if only final values are kept)
+    std::vector<uint32_t> spp;
+    std::vector<double> N;
+    std::vector<double> V;
+    std::vector<double> Vp;         // (empty if `pheno` is false)
+
+    RepOutput() : time(), spp(), N(), V(), Vp() {}
+    RepOutput(const OneRepInfo& info,
+              const uint32_t& q,
+              const bool& through_time,
+              const bool& pheno)
+        : time(), spp(), N(), V(), Vp() {
+
+        const uint64_t nr = info.n_rows(through_time);
+        if (through_time) time.reserve(nr);
+        spp.reserve(nr);
+        N.reserve(nr);
+        V.reserve(nr * q);
+        if (pheno) Vp.reserve(nr * q);
+
+        if (through_time) {
+            for (uint32_t i = 0; i < info.t.size(); i++) {
+                for (uint32_t k = 0; k < info.N_t[i].size(); k++) {
+                    time.push_back(info.t[i]);
+                    add_row(info.spp_t[i][k], info.N_t[i][k],
+                            info.V_t[i][k], info.Vp_t[i][k], pheno);
+                }
+            }
+        } else if (!info.N.empty()) {
+            for (uint32_t k = 0; k < info.N.size(); k++) {
+                add_row(info.spp[k], info.N[k], info.V[k], info.Vp[k], pheno);
+            }
+        } else {
+            // Row of NaNs if everything's extinct:
+            arma::vec nan_V(q);
+            nan_V.fill(arma::datum::nan);
+            add_row(0, 0, nan_V, nan_V, pheno);
+        }
+
+    }
+
+    inline uint64_t n_rows() const { return N.size(); }
+
+private:
+
+    inline void add_row(const uint32_t& spp_, const double& N_,
+                        const arma::vec& V_, const arma::vec& Vp_,
+                        const bool& pheno) {
+        spp.push_back(spp_);
+        N.push_back(N_);
+        V.insert(V.end(), V_.begin(), V_.end());
+        if (pheno) Vp.insert(Vp.end(), Vp_.begin(), Vp_.end());
+        return;
+    }
+
+};
+
+
+
+/*
+ Whether the community has stopped changing since `N_last` and `V_last`.
+ */
+inline bool has_converged(const OneRepInfo& info,
+                          const std::vector<double>& N_last,
+                          const std::vector<arma::vec>& V_last,
+                          const std::vector<uint32_t>& spp_last,
+                          const double& conv_tol) {
+    if (info.spp != spp_last) return false;
+    for (uint32_t i = 0; i < info.N.size(); i++) {
+        if (std::abs(info.N[i] - N_last[i]) > conv_tol * N_last[i]) {
+            return false;
+        }
+        for (uint32_t l = 0; l < info.V[i].n_elem; l++) {
+            if (std::abs(info.V[i](l) - V_last[i](l)) > conv_tol) return false;
+        }
+    }
+    return true;
+}
+
+
+
+/*
+ One repetition of quantitative genetics.
+
+ Higher-up function(s) should handle the info put into `info`.
+ `P` is the type of progress bar, which needs `increment`, `is_aborted`,
+ and `check_abort` methods (e.g., `Progress` from RcppProgress).
+ */
+template <typename P>
+void one_quant_gen__(int& status,
+                     OneRepInfo& info,
+                     std::deque<arma::vec> V0,
+                     std::deque<arma::vec> Vp0,
+                     std::deque<double> N0,
+                     const double& f,
+                     const double& a0,
+                     const arma::mat& C,
+                     const double& r0,
+                     const arma::mat& D,
+                     std::deque<double> add_var,
+                     const double& sigma_V0,
+                     const double& sigma_N,
+                     const std::vector<double>& sigma_V,
+                     const uint32_t& spp_gap_t,
+                     const uint32_t& final_t,
+                     const double& min_N,
+                     const uint32_t& save_every,
+                     pcg64& eng,
+                     P& prog_bar,
+                     const NoiseOptions& noise_opts = NoiseOptions(),
+                     const TangentOptions& tan_opts = TangentOptions(),
+                     const SummaryOptions& summ_opts = SummaryOptions(),
+                     const StreamOptions& stream_opts = StreamOptions()) {
+
+    if (status != 0) return; // previous user interrupt
+
+
+    uint32_t n = N0.size();
+    uint32_t q = V0.front().n_elem;
+
+    normal_distr distr = normal_distr(0, 1);
+
+    std::vector<SppNoise> spp_noise;
+    if (noise_opts.by_species) {
+        spp_noise.reserve(n);
+        for (uint32_t i = 0; i < n; i++) {
+            spp_noise.push_back(SppNoise(eng, i, noise_opts.antithetic));
+        }
+        /*
+         Starting genotypes and phenotypes from each species' stream.
+         Deviates are drawn whether or not they're used, so streams stay
+         lined up among reps with different parameters.
+         */
+        bool make_Vp0 = Vp0.size() == 0 || sigma_V0 > 0;
+        if (make_Vp0) Vp0 = V0;
+        for (uint32_t i = 0; i < n; i++) {
+            for (uint32_t j = 0; j < q; j++) {
+                double u = spp_noise[i].unif();
+                double z = spp_noise[i].norm();
+                if (sigma_V0 > 0) {
+                    V0[i][j] = trunc_rnorm_u_(V0[i][j], sigma_V0, u);
+                }
+                if (make_Vp0) Vp0[i][j] = V0[i][j] * std::exp(z * sigma_V[j]);
+            }
+        }
+    }
+
+    // adding stochasticity to starting genotypes (and phenotypes if desired)
+    if (!noise_opts.by_species && sigma_V0 > 0) {
+        Vp0 = V0; // mostly just to resize `Vp0`
+        for (uint32_t i = 0; i < n; i++) {
+            for (uint32_t j = 0; j < q; j++) {
+                V0[i][j] = trunc_rnorm_(V0[i][j], sigma_V0, eng);
+                Vp0[i][j] = V0[i][j];
+                if (sigma_V[j] > 0) {
+                    Vp0[i][j] *= std::exp(distr(eng) * sigma_V[j]);
+                }
+            }
+        }
+    }
+
+    /*
+     adjusting starting phenotypes if `sigma_V0 == 0`
+     */
+    if (Vp0.size() == 0) {
+        Vp0 = V0;
+        for (uint32_t j = 0; j < q; j++) {
+            if (sigma_V[j] > 0) {
+                for (uint32_t i = 0; i < n; i++) {
+                    Vp0[i][j] *= std::exp(distr(eng) * sigma_V[j]);
+                }
+            }
+        }
+    }
+
+
+    if (spp_gap_t == 0) {
+        info = OneRepInfo(N0, V0, Vp0, add_var);
+        N0.clear();
+        V0.clear();
+        Vp0.clear();
+        add_var.clear();
+    } else {
+        info = OneRepInfo(N0.front(), V0.front(), Vp0.front(), add_var.front());
+        N0.pop_front();
+        V0.pop_front();
+        Vp0.pop_front();
+        add_var.pop_front();
+    }
+
+    if (noise_opts.by_species) info.set_spp_noise(spp_noise);
+    if (tan_opts.sens || tan_opts.n_lyap > 0) info.track_tangent(tan_opts);
+
+    /*
+     For summaries, the final window is relative to the total time, which is
+     the time to add all species plus `final_t`:
+     */
+    const uint32_t summ_total_t = final_t +
+        ((spp_gap_t > 0) ? (n - 1) * spp_gap_t : 0U);
+    auto update_summary = [&](const uint32_t& t_) {
+        if (!summ_opts.track) return;
+        info.update_summary(t_, t_ + summ_opts.window > summ_total_t);
+        return;
+    };
+    if (summ_opts.track) info.start_summary(n);
+    if (stream_opts.buf != nullptr) info.stream_to(stream_opts);
+
+
+    // Setting size for `info` fields
+    if (save_every > 0) {
+        uint32_t spp_add_saves = static_cast<uint32_t>(std::ceil(
+            static_cast<double>(spp_gap_t) / static_cast<double>(save_every)));
+        spp_add_saves += 2U;
+        uint32_t final_saves = static_cast<uint32_t>(std::ceil(
+            static_cast<double>(final_t) / static_cast<double>(save_every)));
+        final_saves += 2U;
+        info.reserve(final_saves + (info.n + V0.size() - 1) * spp_add_saves);
+    }
+
+    uint32_t t = 0;
+    bool all_gone = false;
+    uint32_t interrupt_iters = 0;   // checking for user interrupt
+    uint32_t n_pb_incr = 0;         // progress bar increments
+
+
+    // Save starting info:
+    if (save_every > 0) info.save_time(t);
+    update_summary(t);
+
+
+    // First iterations with species additions
+    bool new_spp = false;
+    while (!N0.empty()) {
+
+        n_pb_incr++;
+
+        // Update abundances and traits:
+        all_gone = info.iterate(f, a0, C, r0, D, min_N,
+                                sigma_N, sigma_V, eng);
+
+        // Add new species if necessary:
+        new_spp = (t + 1) == (info.n * spp_gap_t);
+        if (new_spp) {
+            info.add_species(N0.front(), V0.front(), Vp0.front(),
+                             add_var.front());
+            N0.pop_front();
+            V0.pop_front();
+            Vp0.pop_front();
+            add_var.pop_front();
+        }
+
+        if (save_every > 0 && (t % save_every == 0 || new_spp)) {
+            info.save_time(t + 1);
+        }
+        update_summary(t + 1);
+
+        if (n_pb_incr > 100) {
+            prog_bar.increment(n_pb_incr);
+            n_pb_incr = 0;
+        }
+
+        t++;
+
+
+        // Check for user interrupt:
+        if (interrupt_check(interrupt_iters, prog_bar, 100)) {
+            status = -1;
+            return;
+        }
+
+    }
+
+    if (final_t == 0) return;
+
+    uint32_t total_time = final_t + t;
+
+    // Final iterations with no species additions
+    while (!all_gone && t < total_time) {
+
+        n_pb_incr++;
+
+        // Update abundances and traits:
+        all_gone = info.iterate(f, a0, C, r0, D, min_N,
+                                sigma_N, sigma_V, eng);
+
+        if (save_every > 0 &&
+            (t % save_every == 0 || (t+1) == final_t || all_gone)) {
+            info.save_time(t + 1);
+        }
+        update_summary(t + 1);
+
+        if (n_pb_incr > 100) {
+            prog_bar.increment(n_pb_incr);
+            n_pb_incr = 0;
+        }
+
+        t++;
+
+        // Check for user interrupt:
+        if (interrupt_check(interrupt_iters, prog_bar, 100)) {
+            status = -1;
+            return;
+        }
+
+    }
+
+    if (n_pb_incr > 0) prog_bar.increment(n_pb_incr);
+
+    return;
+}
+
+
+
+
 // Below is useful when doing plots of fitness landscapes:
 // /*
 //  Data for each combination of trial, time, and species.
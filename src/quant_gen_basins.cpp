@@ -0,0 +1,395 @@
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <random>
+#include <vector>
+#include <deque>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Quantitative genetics for basin-of-attraction maps.
+
+ Each rep stops as soon as its community is within a tolerance of one of
+ a set of known attractors, or once it has gone totally extinct.
+ This is much cheaper than always simulating the full `final_t` time steps
+ when all that's needed is which attractor each rep ends up at.
+ */
+
+
+
+/*
+ Catalog of known attractors.
+ Each attractor is a set of species' traits and abundances, plus optionally
+ the species indexes that must be present.
+ */
+class AttractorCatalog {
+public:
+
+    std::vector<std::vector<arma::vec>> V;
+    std::vector<std::vector<double>> N;
+    std::vector<std::vector<uint32_t>> spp;
+    double tol_V;   // max absolute difference in any trait
+    double tol_N;   // max difference in abundance, relative to attractor's
+
+    AttractorCatalog(const std::vector<arma::mat>& V_,
+                     const std::vector<std::vector<double>>& N_,
+                     const std::vector<std::vector<uint32_t>>& spp_,
+                     const double& tol_V_,
+                     const double& tol_N_)
+        : V(V_.size()), N(N_), spp(spp_), tol_V(tol_V_), tol_N(tol_N_) {
+
+        if (N_.size() != V_.size()) stop("attractors' V and N sizes differ");
+        if (spp_.size() != V_.size()) stop("attractors' V and spp sizes differ");
+
+        for (uint32_t k = 0; k < V_.size(); k++) {
+            if (V_[k].n_cols != N_[k].size()) {
+                stop(std::string("\nV.n_cols != N.size() for attractor ") +
+                    std::to_string(k + 1));
+            }
+            if (!spp_[k].empty() && spp_[k].size() != N_[k].size()) {
+                stop(std::string("\nspp.size() != N.size() for attractor ") +
+                    std::to_string(k + 1));
+            }
+            V[k].reserve(V_[k].n_cols);
+            for (uint32_t j = 0; j < V_[k].n_cols; j++) {
+                V[k].push_back(V_[k].col(j));
+            }
+        }
+
+    }
+
+    /*
+     Returns the (1-based) index of the first attractor that `info` is
+     close to, or 0 if there are none.
+     */
+    int match(const OneRepInfo& info) const {
+        for (uint32_t k = 0; k < N.size(); k++) {
+            if (info.N.size() != N[k].size()) continue;
+            if (match_one(info, k)) return static_cast<int>(k + 1);
+        }
+        return 0;
+    }
+
+private:
+
+    inline bool close(const arma::vec& V1, const double& N1,
+                      const uint32_t& k, const uint32_t& j) const {
+        if (std::abs(N1 - N[k][j]) > tol_N * N[k][j]) return false;
+        for (uint32_t l = 0; l < V1.n_elem; l++) {
+            if (std::abs(V1(l) - V[k][j](l)) > tol_V) return false;
+        }
+        return true;
+    }
+
+    bool match_one(const OneRepInfo& info, const uint32_t& k) const {
+
+        uint32_t n = info.N.size();
+
+        // Species identities matter:
+        if (!spp[k].empty()) {
+            for (uint32_t i = 0; i < n; i++) {
+                // `info.spp` is always in increasing order
+                if (info.spp[i] != spp[k][i]) return false;
+                if (!close(info.V[i], info.N[i], k, i)) return false;
+            }
+            return true;
+        }
+
+        // Otherwise match species to attractor points in any order:
+        std::vector<bool> used(n, false);
+        for (uint32_t i = 0; i < n; i++) {
+            bool found = false;
+            for (uint32_t j = 0; j < n; j++) {
+                if (used[j]) continue;
+                if (close(info.V[i], info.N[i], k, j)) {
+                    used[j] = true;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) return false;
+        }
+        return true;
+    }
+
+};
+
+
+
+
+//' Final time steps for one rep, stopping once its outcome is known.
+//'
+//' `outcome` is set to the index of the attractor reached, 0 for total
+//' extinction, -1 for converging somewhere not in the catalog, and
+//' left as `NA_INTEGER` if none of these happen by the end.
+//' `hit_t` is set to the time when the outcome was determined.
+//'
+//' @noRd
+//'
+void one_basin_final__(int& status,
+                       int& outcome,
+                       int& hit_t,
+                       OneRepInfo& info,
+                       const AttractorCatalog& catalog,
+                       const double& f,
+                       const double& a0,
+                       const arma::mat& C,
+                       const double& r0,
+                       const arma::mat& D,
+                       const double& sigma_N,
+                       const std::vector<double>& sigma_V,
+                       const uint32_t& start_t,
+                       const uint32_t& final_t,
+                       const double& min_N,
+                       const uint32_t& check_every,
+                       const double& conv_tol,
+                       pcg64& eng,
+                       Progress& prog_bar) {
+
+    outcome = NA_INTEGER;
+    hit_t = NA_INTEGER;
+
+    if (status != 0) return; // previous user interrupt
+
+    uint32_t t = start_t;
+    uint32_t total_time = start_t + final_t;
+    bool all_gone = info.N.empty();
+    uint32_t interrupt_iters = 0;   // checking for user interrupt
+    uint32_t n_pb_incr = 0;         // progress bar increments
+
+    std::vector<double> N_last = info.N;
+    std::vector<arma::vec> V_last = info.V;
+    std::vector<uint32_t> spp_last = info.spp;
+
+    while (t < total_time) {
+
+        if (all_gone) {
+            outcome = 0;
+            hit_t = t;
+            break;
+        }
+
+        if ((t - start_t) % check_every == 0) {
+            int k = catalog.match(info);
+            if (k > 0) {
+                outcome = k;
+                hit_t = t;
+                break;
+            }
+            if (conv_tol > 0 && t > start_t) {
+                if (has_converged(info, N_last, V_last, spp_last, conv_tol)) {
+                    outcome = -1;
+                    hit_t = t;
+                    break;
+                }
+                N_last = info.N;
+                V_last = info.V;
+                spp_last = info.spp;
+            }
+        }
+
+        n_pb_incr++;
+
+        // Update abundances and traits:
+        all_gone = info.iterate(f, a0, C, r0, D, min_N,
+                                sigma_N, sigma_V, eng);
+
+        if (n_pb_incr > 100) {
+            prog_bar.increment(n_pb_incr);
+            n_pb_incr = 0;
+        }
+
+        t++;
+
+        // Check for user interrupt:
+        if (interrupt_check(interrupt_iters, prog_bar, 100)) {
+            status = -1;
+            return;
+        }
+
+    }
+
+    // Check the very last state, too:
+    if (t == total_time && outcome == NA_INTEGER) {
+        if (all_gone) {
+            outcome = 0;
+            hit_t = t;
+        } else {
+            int k = catalog.match(info);
+            if (k > 0) {
+                outcome = k;
+                hit_t = t;
+            }
+        }
+    }
+
+    // Count skipped time steps as done for the progress bar:
+    n_pb_incr += (total_time - t);
+    if (n_pb_incr > 0) prog_bar.increment(n_pb_incr);
+
+    return;
+}
+
+
+
+
+//' Multiple repetitions of quantitative genetics, classified by outcome.
+//'
+//' Species are added the same way as in `quant_gen_cpp`.
+//' Afterwards, reps are stopped once they reach an attractor in the catalog
+//' made from `attr_V`, `attr_N`, and `attr_spp`.
+//'
+//' Returns a list with `nv` (final values, formatted the same as
+//' `quant_gen_cpp` with `save_every = 0`), `outcome`, and `time`.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List quant_gen_basins_cpp(const uint32_t& n_reps,
+                          const std::deque<arma::vec>& V0,
+                          const std::deque<double>& N0,
+                          const double& f,
+                          const double& a0,
+                          const arma::mat& C,
+                          const double& r0,
+                          const arma::mat& D,
+                          const std::deque<double>& add_var,
+                          const double& sigma_V0,
+                          const double& sigma_N,
+                          const std::vector<double>& sigma_V,
+                          const uint32_t& spp_gap_t,
+                          const uint32_t& final_t,
+                          const double& min_N,
+                          const std::vector<arma::mat>& attr_V,
+                          const std::vector<std::vector<double>>& attr_N,
+                          const std::vector<std::vector<uint32_t>>& attr_spp,
+                          const double& tol_V,
+                          const double& tol_N,
+                          const double& conv_tol,
+                          const uint32_t& check_every,
+                          const bool& show_progress,
+                          const uint32_t& n_threads) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+
+    const uint32_t n = N0.size();
+
+    if (n == 0) stop("n == 0");
+    if (check_every == 0) stop("check_every == 0");
+
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+
+    const uint32_t q = V0[0].n_elem;
+    if (C.n_cols != q) stop("C.n_cols != q");
+    if (C.n_rows != q) stop("C.n_rows != q");
+    if (D.n_cols != q) stop("D.n_cols != q");
+    if (D.n_rows != q) stop("D.n_rows != q");
+    for (const arma::mat& av : attr_V) {
+        if (av.n_cols > 0 && av.n_rows != q) stop("attractors' V.n_rows != q");
+    }
+
+    const AttractorCatalog catalog(attr_V, attr_N, attr_spp, tol_V, tol_N);
+
+    std::vector<OneRepInfo> rep_infos(n_reps);
+    std::vector<int> outcome(n_reps);
+    std::vector<int> hit_t(n_reps);
+
+    const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_reps);
+
+    Progress prog_bar(n_reps * (final_t + (n - 1) * spp_gap_t), show_progress);
+    bool interrupted = false;
+
+    // Starting phenotypes are made inside `one_quant_gen__`:
+    const std::deque<arma::vec> Vp0;
+    // Time when the last species is added:
+    const uint32_t start_t = (n - 1) * spp_gap_t;
+
+    #ifdef _OPENMP
+    #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+    {
+    #endif
+
+
+    #ifdef _OPENMP
+    uint32_t active_thread = omp_get_thread_num();
+    #else
+    uint32_t active_thread = 0;
+    #endif
+
+    int status = 0;
+
+    pcg64 eng;
+
+    // Dynamic scheduling because reps can stop at very different times:
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for (uint32_t i = 0; i < n_reps; i++) {
+        eng.seed(seeds[i][0], seeds[i][1]);
+        // Species additions only:
+        one_quant_gen__(status,
+                        rep_infos[i], V0, Vp0, N0, f, a0, C, r0, D,
+                        add_var, sigma_V0, sigma_N, sigma_V,
+                        spp_gap_t, 0U, min_N,
+                        0U, eng, prog_bar);
+        one_basin_final__(status, outcome[i], hit_t[i], rep_infos[i],
+                          catalog, f, a0, C, r0, D, sigma_N, sigma_V,
+                          start_t, final_t, min_N, check_every, conv_tol,
+                          eng, prog_bar);
+
+        if (active_thread == 0 && status != 0) interrupted = true;
+    }
+    #ifdef _OPENMP
+    }
+    #endif
+
+    if (interrupted) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    /*
+     ------------
+     Now organize output:
+     ------------
+     */
+    std::vector<uint32_t> cum_rows(n_reps, 0);
+    uint32_t n_rows = 0;
+    for (uint32_t i = 0; i < n_reps; i++) {
+        cum_rows[i] = n_rows;
+        n_rows += rep_infos[i].n_rows(false);
+    }
+
+    arma::mat nv(n_rows, 3 + 2 * q);
+
+    #ifdef _OPENMP
+    #pragma omp parallel for default(shared) num_threads(n_threads) schedule(static)
+    #endif
+    for (uint32_t i = 0; i < n_reps; i++) {
+        std::vector<double> ids(1, static_cast<double>(i + 1));
+        rep_infos[i].fill_matrix(nv, ids, cum_rows[i], false);
+    }
+
+    List out = List::create(_["nv"] = nv,
+                            _["outcome"] = outcome,
+                            _["time"] = hit_t);
+
+    return out;
+
+}
+
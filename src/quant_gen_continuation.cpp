@@ -0,0 +1,366 @@
+
+
+
+#include <RcppArmadillo.h>
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include "sim.hpp"
+#include "quant_gen.hpp"
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Pseudo-arclength continuation of equilibria for deterministic
+ quantitative genetics.
+
+ The state `x` has all species' traits (species by species, as in
+ `jacobian_cpp`) followed by all abundances.
+ An equilibrium is where `G(x, p) - x = 0`, where `G` is one time step
+ and `p` is the parameter being varied.
+ `C` and `D` depend linearly on `p`: `C = C0 + p * dC` and `D = D0 + p * dD`.
+ */
+
+
+
+/*
+ One time step of deterministic quantitative genetics (the same as
+ `OneRepInfo::iterate` without stochasticity or extinctions).
+ */
+class QuantGenMap {
+public:
+
+    const uint32_t n;
+    const uint32_t q;
+    const double f;
+    const double a0;
+    const double r0;
+    const arma::mat C0;
+    const arma::mat dC;
+    const arma::mat D0;
+    const arma::mat dD;
+    const arma::vec add_var;
+
+    QuantGenMap(const uint32_t& n_, const uint32_t& q_,
+                const double& f_, const double& a0_, const double& r0_,
+                const arma::mat& C0_, const arma::mat& dC_,
+                const arma::mat& D0_, const arma::mat& dD_,
+                const arma::vec& add_var_)
+        : n(n_), q(q_), f(f_), a0(a0_), r0(r0_),
+          C0(C0_), dC(dC_), D0(D0_), dD(dD_), add_var(add_var_),
+          V(n_, arma::vec(q_)), N(n_), A(n_), ss_mat() {};
+
+    inline arma::mat C(const double& p) const { return C0 + p * dC; }
+    inline arma::mat D(const double& p) const { return D0 + p * dD; }
+
+    // G(x, p) - x
+    arma::vec residual(const arma::vec& x, const double& p) {
+
+        const arma::mat C_ = C(p);
+        const arma::mat D_ = D(p);
+
+        unpack(x);
+
+        A_VN_<std::vector<double>>(A, V, N, a0, D_);
+        for (uint32_t i = 0; i < n; i++) {
+            double r = r_V_<arma::vec>(V[i], f, C_, r0);
+            N[i] *= std::exp(r - A[i]);
+        }
+
+        sel_str__(ss_mat, V, N, f, a0, C_, r0, D_);
+
+        arma::vec out(x.n_elem);
+        for (uint32_t i = 0; i < n; i++) {
+            for (uint32_t j = 0; j < q; j++) {
+                double Vij = V[i](j) + add_var(i) * ss_mat(j,i);
+                if (Vij < 0) Vij = 0; // <-- keeping traits >= 0
+                out(i * q + j) = Vij - x(i * q + j);
+            }
+            out(n * q + i) = N[i] - x(n * q + i);
+        }
+
+        return out;
+    }
+
+    // Jacobian of G with respect to x
+    arma::mat jacobian(const arma::vec& x, const double& p) const {
+        arma::mat Vm = arma::reshape(x.head(n * q), q, n);
+        std::vector<double> Nv(x.begin() + n * q, x.end());
+        return jacobian_cpp(Vm, Nv, f, a0, r0, D(p), C(p), add_var, false);
+    }
+
+    // Derivative of G with respect to p (by central differences)
+    arma::vec dG_dp(const arma::vec& x, const double& p) {
+        double h = 1e-6 * std::max(1.0, std::abs(p));
+        return (residual(x, p + h) - residual(x, p - h)) / (2 * h);
+    }
+
+private:
+
+    std::vector<arma::vec> V;
+    std::vector<double> N;
+    std::vector<double> A;
+    arma::mat ss_mat;
+
+    void unpack(const arma::vec& x) {
+        for (uint32_t i = 0; i < n; i++) {
+            V[i] = x.subvec(i * q, i * q + q - 1);
+            N[i] = x(n * q + i);
+        }
+        return;
+    }
+
+};
+
+
+
+/*
+ Tangent to the branch at (x, p), for scaled variables.
+ `t_prev` sets the orientation (and is used as the extra row in the
+ augmented system).
+ Returns false if the system is singular.
+ */
+bool branch_tangent(arma::vec& tangent,
+                    const arma::mat& Fy,
+                    const arma::vec& t_prev) {
+
+    const uint32_t m = Fy.n_cols;
+    arma::mat aug(m, m);
+    aug.head_rows(m - 1) = Fy;
+    aug.row(m - 1) = t_prev.t();
+    arma::vec rhs(m, arma::fill::zeros);
+    rhs(m - 1) = 1;
+
+    bool ok = arma::solve(tangent, aug, rhs);
+    if (!ok || !tangent.is_finite()) return false;
+    tangent /= arma::norm(tangent);
+
+    return true;
+}
+
+
+
+//' Pseudo-arclength continuation of an equilibrium.
+//'
+//' `V0` and `N0` are a starting guess for the equilibrium at `p0`.
+//' Continuation stops after `max_steps` points, when `p` leaves `p_range`,
+//' when a species' abundance reaches zero, or when Newton's method fails
+//' even at the smallest step size.
+//'
+//' Returns a list with `p`, `x` (one row per point), `max_mod` (largest
+//' modulus of the Jacobian's eigenvalues), `crossing` (argument of the
+//' eigenvalue with the largest modulus), `dp_ds` (the parameter's
+//' component of the tangent), `n_solves` (total linear solves),
+//' and `end` (why it stopped).
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List quant_gen_continuation_cpp(const arma::mat& V0,
+                                const arma::vec& N0,
+                                const double& p0,
+                                const double& f,
+                                const double& a0,
+                                const double& r0,
+                                const arma::mat& C0,
+                                const arma::mat& dC,
+                                const arma::mat& D0,
+                                const arma::mat& dD,
+                                const arma::vec& add_var,
+                                const double& direction,
+                                double ds,
+                                const double& ds_min,
+                                const double& ds_max,
+                                const uint32_t& max_steps,
+                                const std::vector<double>& p_range,
+                                const double& tol,
+                                const uint32_t& max_iter) {
+
+    const uint32_t n = N0.n_elem;
+    const uint32_t q = V0.n_rows;
+    const uint32_t nx = n * q + n;
+
+    if (n == 0) stop("n == 0");
+    if (V0.n_cols != n) stop("V0.n_cols != N0.n_elem");
+    if (add_var.n_elem != n) stop("add_var.n_elem != n");
+    if (p_range.size() != 2) stop("p_range.size() != 2");
+    for (const arma::mat* M : {&C0, &dC, &D0, &dD}) {
+        if (M->n_rows != q || M->n_cols != q) stop("C0, dC, D0, or dD not q x q");
+        if (!M->is_symmetric()) stop("C0, dC, D0, and dD must be symmetric");
+    }
+
+    QuantGenMap G(n, q, f, a0, r0, C0, dC, D0, dD, add_var);
+
+    arma::vec x(nx);
+    x.head(n * q) = arma::vectorise(V0);
+    x.tail(n) = N0;
+    double p = p0;
+
+    // Scales so that traits and abundances have similar magnitudes:
+    arma::vec scale = arma::abs(x);
+    scale.transform([](double s) { return std::max(s, 1.0); });
+
+    uint32_t n_solves = 0;
+
+    // Jacobian of [G(x, p) - x] wrt scaled x and p:
+    auto F_y = [&](const arma::vec& x_, const double& p_) {
+        arma::mat Fy(nx, nx + 1);
+        arma::mat Jx = G.jacobian(x_, p_);
+        Jx.diag() -= 1;
+        Jx.each_row() %= scale.t();
+        Jx.each_col() /= scale;
+        Fy.head_cols(nx) = Jx;
+        Fy.col(nx) = G.dG_dp(x_, p_) / scale;
+        return Fy;
+    };
+
+    /*
+     ------------
+     Newton's method at fixed `p0` for the first point:
+     ------------
+     */
+    bool converged = false;
+    for (uint32_t iter = 0; iter < max_iter; iter++) {
+        arma::vec F = G.residual(x, p);
+        if (arma::norm(F / scale, "inf") < tol) {
+            converged = true;
+            break;
+        }
+        arma::mat Jx = G.jacobian(x, p);
+        Jx.diag() -= 1;
+        arma::vec dx;
+        n_solves++;
+        if (!arma::solve(dx, Jx, -F)) break;
+        x += dx;
+    }
+    if (!converged) {
+        stop("\nNewton's method didn't converge at the starting parameter value.");
+    }
+
+
+    std::vector<double> p_out;
+    std::vector<arma::vec> x_out;
+    std::vector<double> max_mod;
+    std::vector<double> crossing;
+    std::vector<double> dp_ds;
+    std::string end = "max_steps";
+
+    // Stability info at the current point:
+    auto save_point = [&](const double& dpds) {
+        arma::cx_vec eigval = arma::eig_gen(G.jacobian(x, p));
+        arma::uword k = arma::index_max(arma::abs(eigval));
+        p_out.push_back(p);
+        x_out.push_back(x);
+        max_mod.push_back(std::abs(eigval(k)));
+        crossing.push_back(std::arg(eigval(k)));
+        dp_ds.push_back(dpds);
+        return;
+    };
+
+    // Starting tangent in the direction of `direction` along p:
+    arma::vec t_prev(nx + 1, arma::fill::zeros);
+    t_prev(nx) = direction;
+    arma::vec tangent;
+    n_solves++;
+    if (!branch_tangent(tangent, F_y(x, p), t_prev)) {
+        stop("\nCan't find the branch's tangent at the starting point.");
+    }
+
+    save_point(tangent(nx));
+
+    /*
+     ------------
+     Predictor-corrector steps along the branch:
+     ------------
+     */
+    for (uint32_t step = 1; step < max_steps; step++) {
+
+        // Scaled current point:
+        arma::vec y(nx + 1);
+        y.head(nx) = x / scale;
+        y(nx) = p;
+
+        bool step_ok = false;
+        arma::vec y_new;
+
+        while (!step_ok) {
+
+            const arma::vec y_pred = y + ds * tangent;
+            y_new = y_pred;
+
+            for (uint32_t iter = 0; iter < max_iter; iter++) {
+                arma::vec x_ = y_new.head(nx) % scale;
+                double p_ = y_new(nx);
+                arma::vec H(nx + 1);
+                H.head(nx) = G.residual(x_, p_) / scale;
+                H(nx) = arma::dot(tangent, y_new - y_pred);
+                if (!H.is_finite()) break;
+                if (arma::norm(H, "inf") < tol) {
+                    step_ok = true;
+                    break;
+                }
+                arma::mat aug(nx + 1, nx + 1);
+                aug.head_rows(nx) = F_y(x_, p_);
+                aug.row(nx) = tangent.t();
+                arma::vec dy;
+                n_solves++;
+                if (!arma::solve(dy, aug, -H)) break;
+                y_new += dy;
+            }
+
+            if (!step_ok) {
+                ds /= 2;
+                if (ds < ds_min) break;
+            }
+        }
+
+        if (!step_ok) {
+            end = "newton_failed";
+            break;
+        }
+
+        x = y_new.head(nx) % scale;
+        p = y_new(nx);
+
+        if (p < p_range[0] || p > p_range[1]) {
+            end = "p_range";
+            break;
+        }
+        if (arma::any(x.tail(n) <= 0)) {
+            end = "extinction";
+            break;
+        }
+
+        arma::vec t_new;
+        n_solves++;
+        if (!branch_tangent(t_new, F_y(x, p), tangent)) {
+            end = "singular";
+            break;
+        }
+        tangent = t_new;
+
+        save_point(tangent(nx));
+
+        ds = std::min(ds * 1.5, ds_max);
+
+        Rcpp::checkUserInterrupt();
+    }
+
+    arma::mat x_mat(x_out.size(), nx);
+    for (uint32_t i = 0; i < x_out.size(); i++) x_mat.row(i) = x_out[i].t();
+
+    List out = List::create(_["p"] = p_out,
+                            _["x"] = x_mat,
+                            _["max_mod"] = max_mod,
+                            _["crossing"] = crossing,
+                            _["dp_ds"] = dp_ds,
+                            _["n_solves"] = n_solves,
+                            _["end"] = end);
+
+    return out;
+
+}
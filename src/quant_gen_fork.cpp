@@ -0,0 +1,298 @@
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <random>
+#include <vector>
+#include <deque>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Snapshot-and-fork version of quantitative genetics.
+
+ The resident community is simulated once per rep up to the time of invasion.
+ That state is then copied into one branch per invader, and each branch
+ continues on its own RNG stream.
+ This avoids re-simulating the same resident phase for every invader.
+ */
+
+
+
+
+
+//' One branch from a resident snapshot.
+//'
+//' `info` should already contain a copy of the resident snapshot.
+//'
+//' @noRd
+//'
+void one_fork_branch__(int& status,
+                       OneRepInfo& info,
+                       arma::vec V_inv,
+                       const double& N_inv,
+                       const double& add_var_inv,
+                       const double& f,
+                       const double& a0,
+                       const arma::mat& C,
+                       const double& r0,
+                       const arma::mat& D,
+                       const double& sigma_V0,
+                       const double& sigma_N,
+                       const std::vector<double>& sigma_V,
+                       const uint32_t& fork_t,
+                       const uint32_t& final_t,
+                       const double& min_N,
+                       const uint32_t& save_every,
+                       pcg64& eng,
+                       Progress& prog_bar) {
+
+    if (status != 0) return; // previous user interrupt
+
+    uint32_t q = V_inv.n_elem;
+
+    normal_distr distr = normal_distr(0, 1);
+
+    // adding stochasticity to invader's genotypes and phenotypes:
+    if (sigma_V0 > 0) {
+        for (uint32_t j = 0; j < q; j++) {
+            V_inv[j] = trunc_rnorm_(V_inv[j], sigma_V0, eng);
+        }
+    }
+    arma::vec Vp_inv = V_inv;
+    for (uint32_t j = 0; j < q; j++) {
+        if (sigma_V[j] > 0) Vp_inv[j] *= std::exp(distr(eng) * sigma_V[j]);
+    }
+
+    info.add_species(N_inv, V_inv, Vp_inv, add_var_inv);
+
+    if (save_every > 0) {
+        uint32_t final_saves = static_cast<uint32_t>(std::ceil(
+            static_cast<double>(final_t) / static_cast<double>(save_every)));
+        info.reserve(final_saves + 2U);
+        info.save_time(fork_t);
+    }
+
+    uint32_t t = fork_t;
+    uint32_t total_time = fork_t + final_t;
+    bool all_gone = false;
+    uint32_t interrupt_iters = 0;   // checking for user interrupt
+    uint32_t n_pb_incr = 0;         // progress bar increments
+
+    while (!all_gone && t < total_time) {
+
+        n_pb_incr++;
+
+        // Update abundances and traits:
+        all_gone = info.iterate(f, a0, C, r0, D, min_N,
+                                sigma_N, sigma_V, eng);
+
+        if (save_every > 0 &&
+            ((t - fork_t) % save_every == 0 || (t+1) == total_time ||
+            all_gone)) {
+            info.save_time(t + 1);
+        }
+
+        if (n_pb_incr > 100) {
+            prog_bar.increment(n_pb_incr);
+            n_pb_incr = 0;
+        }
+
+        t++;
+
+        // Check for user interrupt:
+        if (interrupt_check(interrupt_iters, prog_bar, 100)) {
+            status = -1;
+            return;
+        }
+
+    }
+
+    if (n_pb_incr > 0) prog_bar.increment(n_pb_incr);
+
+    return;
+}
+
+
+
+
+//' Quantitative genetics, with invaders forked from resident snapshots.
+//'
+//' All species in `V0` are residents that start together at time 0.
+//' After `fork_t` time steps, each rep's resident state is copied once
+//' per column in `V_inv`, and each copy is invaded by that species and
+//' simulated for another `final_t` time steps.
+//'
+//' The output matrix has the columns
+//' `rep, inv, [time,] spp, N, geno_1..q, pheno_1..q`, where `time` is
+//' only present if `save_every > 0`.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+arma::mat quant_gen_fork_cpp(const uint32_t& n_reps,
+                             const std::deque<arma::vec>& V0,
+                             const std::deque<double>& N0,
+                             const std::deque<double>& add_var,
+                             const std::vector<arma::vec>& V_inv,
+                             const double& N_inv,
+                             const double& add_var_inv,
+                             const double& f,
+                             const double& a0,
+                             const arma::mat& C,
+                             const double& r0,
+                             const arma::mat& D,
+                             const double& sigma_V0,
+                             const double& sigma_N,
+                             const std::vector<double>& sigma_V,
+                             const uint32_t& fork_t,
+                             const uint32_t& final_t,
+                             const double& min_N,
+                             const uint32_t& save_every,
+                             const bool& show_progress,
+                             const uint32_t& n_threads) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+
+    const uint32_t n = N0.size();
+    const uint32_t n_inv = V_inv.size();
+
+    if (n == 0) stop("n == 0");
+    if (n_inv == 0) stop("V_inv.size() == 0");
+
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+
+    const uint32_t q = V0[0].n_elem;
+    if (C.n_cols != q) stop("C.n_cols != q");
+    if (C.n_rows != q) stop("C.n_rows != q");
+    if (D.n_cols != q) stop("D.n_cols != q");
+    if (D.n_rows != q) stop("D.n_rows != q");
+    if (sigma_V.size() != q) stop("sigma_V.size() != q");
+    for (uint32_t k = 0; k < n_inv; k++) {
+        if (V_inv[k].n_elem != q) stop("all items in V_inv must have length q");
+    }
+
+    const uint32_t n_branches = n_reps * n_inv;
+
+    std::vector<OneRepInfo> res_infos(n_reps);
+    std::vector<OneRepInfo> branch_infos(n_branches);
+
+    const std::vector<std::vector<uint128_t>> res_seeds = mc_seeds_rep(n_reps);
+    const std::vector<std::vector<uint128_t>> branch_seeds =
+        mc_seeds_rep(n_branches);
+
+    Progress prog_bar(n_reps * fork_t + n_branches * final_t, show_progress);
+    bool interrupted = false;
+
+    // Residents start together, so use no time gap between them:
+    const std::deque<arma::vec> Vp0;
+    const uint32_t spp_gap_t = 0;
+
+    #ifdef _OPENMP
+    #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+    {
+    #endif
+
+
+    #ifdef _OPENMP
+    uint32_t active_thread = omp_get_thread_num();
+    #else
+    uint32_t active_thread = 0;
+    #endif
+
+    int status = 0;
+
+    pcg64 eng;
+
+    /*
+     Resident phase, once per rep:
+     */
+    #ifdef _OPENMP
+    #pragma omp for schedule(static)
+    #endif
+    for (uint32_t i = 0; i < n_reps; i++) {
+        eng.seed(res_seeds[i][0], res_seeds[i][1]);
+        one_quant_gen__(status,
+                        res_infos[i], V0, Vp0, N0, f, a0, C, r0, D,
+                        add_var, sigma_V0, sigma_N, sigma_V,
+                        spp_gap_t, fork_t, min_N,
+                        0U, eng, prog_bar);
+    }
+
+    /*
+     Invasion phase, once per branch (i.e., per rep and invader).
+     Using dynamic scheduling because branches where everything goes
+     extinct finish early.
+     */
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for (uint32_t b = 0; b < n_branches; b++) {
+        if (status != 0) continue;
+        uint32_t i = b / n_inv;
+        uint32_t k = b % n_inv;
+        branch_infos[b] = res_infos[i];
+        eng.seed(branch_seeds[b][0], branch_seeds[b][1]);
+        one_fork_branch__(status, branch_infos[b], V_inv[k], N_inv,
+                          add_var_inv, f, a0, C, r0, D,
+                          sigma_V0, sigma_N, sigma_V,
+                          fork_t, final_t, min_N,
+                          save_every, eng, prog_bar);
+    }
+
+    if (active_thread == 0 && status != 0) interrupted = true;
+    #ifdef _OPENMP
+    }
+    #endif
+
+    if (interrupted) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    // Residents are no longer needed:
+    res_infos.clear();
+
+    /*
+     ------------
+     Now organize output:
+     ------------
+     */
+    const bool through_time = save_every > 0;
+    const uint32_t n_cols = (through_time ? 5 : 4) + 2 * q;
+
+    std::vector<uint32_t> cum_rows(n_branches, 0);
+    uint32_t n_rows = 0;
+    for (uint32_t b = 0; b < n_branches; b++) {
+        cum_rows[b] = n_rows;
+        n_rows += branch_infos[b].n_rows(through_time);
+    }
+
+    arma::mat nv(n_rows, n_cols);
+
+    #ifdef _OPENMP
+    #pragma omp parallel for default(shared) num_threads(n_threads) schedule(static)
+    #endif
+    for (uint32_t b = 0; b < n_branches; b++) {
+        std::vector<double> ids = {static_cast<double>(b / n_inv + 1),
+                                   static_cast<double>(b % n_inv + 1)};
+        branch_infos[b].fill_matrix(nv, ids, cum_rows[b], through_time);
+    }
+
+    return nv;
+
+}
+
@@ -0,0 +1,445 @@
+
+
+#include <RcppArmadillo.h>
+#include <random>
+#include <vector>
+#include <deque>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <memory>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Quantitative genetics simulations that run in the background.
+
+ A `QuantGenJob` runs all reps on a thread separate from R's main thread
+ (which itself starts OpenMP threads), so R isn't blocked while they run.
+ Nothing on these threads uses the R API: seeds are drawn before starting,
+ and progress and cancellation go through atomics.
+ Because `Rcpp::stop` uses the R API, everything it would be called for inside
+ `one_quant_gen__` is checked in `qg_job_start_cpp` before the thread starts.
+ Any other exception on these threads is caught, and its message is
+ rethrown on R's thread when results are collected.
+ R can then check on the job and collect reps that have finished.
+ */
+
+
+
+/*
+ Stands in for RcppProgress's `Progress` on background threads.
+ There's one per thread, and it also counts steps for the current rep so that
+ steps skipped by a rep ending early (e.g., when everything goes extinct)
+ can be added when it finishes.
+ */
+class JobProgress {
+public:
+
+    JobProgress(std::atomic<uint64_t>& steps_done_,
+                const std::atomic<bool>& cancelled_)
+        : steps_done(steps_done_), cancelled(cancelled_), rep_steps(0) {};
+
+    void increment(unsigned long n = 1) {
+        steps_done.fetch_add(n, std::memory_order_relaxed);
+        rep_steps += n;
+        return;
+    }
+    // Call when a rep finishes to add any steps it didn't run:
+    void finish_rep(const uint64_t& steps_per_rep) {
+        if (rep_steps < steps_per_rep) {
+            steps_done.fetch_add(steps_per_rep - rep_steps,
+                                 std::memory_order_relaxed);
+        }
+        rep_steps = 0;
+        return;
+    }
+    // Call when a rep stops without finishing:
+    void reset_rep() {
+        rep_steps = 0;
+        return;
+    }
+    bool is_aborted() const {
+        return cancelled.load(std::memory_order_relaxed);
+    }
+    bool check_abort() {
+        return cancelled.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t>& steps_done;
+    const std::atomic<bool>& cancelled;
+    uint64_t rep_steps;
+};
+
+
+
+class QuantGenJob {
+public:
+
+    // Inputs:
+    const std::deque<arma::vec> V0;
+    const std::deque<arma::vec> Vp0;
+    const std::deque<double> N0;
+    const double f;
+    const double a0;
+    const arma::mat C;
+    const double r0;
+    const arma::mat D;
+    const std::deque<double> add_var;
+    const double sigma_V0;
+    const double sigma_N;
+    const std::vector<double> sigma_V;
+    const uint32_t spp_gap_t;
+    const uint32_t final_t;
+    const double min_N;
+    const uint32_t save_every;
+    const uint32_t n_threads;
+    const std::vector<std::vector<uint128_t>> seeds;
+
+    // Output and status:
+    std::vector<OneRepInfo> rep_infos;
+    std::vector<std::atomic<bool>> rep_done;
+    std::atomic<uint64_t> steps_done;
+    const uint64_t steps_per_rep;
+    const uint64_t total_steps;
+    std::atomic<bool> cancelled;
+    std::atomic<bool> finished;
+    std::string error;              // only read once `finished` is true
+
+    QuantGenJob(const uint32_t& n_reps,
+                const std::deque<arma::vec>& V0_,
+                const std::deque<arma::vec>& Vp0_,
+                const std::deque<double>& N0_,
+                const double& f_,
+                const double& a0_,
+                const arma::mat& C_,
+                const double& r0_,
+                const arma::mat& D_,
+                const std::deque<double>& add_var_,
+                const double& sigma_V0_,
+                const double& sigma_N_,
+                const std::vector<double>& sigma_V_,
+                const uint32_t& spp_gap_t_,
+                const uint32_t& final_t_,
+                const double& min_N_,
+                const uint32_t& save_every_,
+                const uint32_t& n_threads_)
+        : V0(V0_), Vp0(Vp0_), N0(N0_), f(f_), a0(a0_), C(C_), r0(r0_), D(D_),
+          add_var(add_var_), sigma_V0(sigma_V0_), sigma_N(sigma_N_),
+          sigma_V(sigma_V_), spp_gap_t(spp_gap_t_), final_t(final_t_),
+          min_N(min_N_), save_every(save_every_), n_threads(n_threads_),
+          seeds(mc_seeds_rep(n_reps)),  // uses R's RNG, so not done in thread
+          rep_infos(n_reps),
+          rep_done(n_reps),
+          steps_done(0),
+          steps_per_rep(final_t_ +
+              static_cast<uint64_t>(N0_.size() - 1) * spp_gap_t_),
+          total_steps(static_cast<uint64_t>(n_reps) * steps_per_rep),
+          cancelled(false),
+          finished(false),
+          error(),
+          worker() {
+        for (std::atomic<bool>& rd : rep_done) rd.store(false);
+    };
+
+    ~QuantGenJob() {
+        cancelled.store(true);
+        if (worker.joinable()) worker.join();
+    }
+
+    void start() {
+        worker = std::thread(&QuantGenJob::run, this);
+        return;
+    }
+
+    void cancel(const bool& wait) {
+        cancelled.store(true);
+        if (wait && worker.joinable()) worker.join();
+        return;
+    }
+
+    uint32_t n_done() const {
+        uint32_t n = 0;
+        for (const std::atomic<bool>& rd : rep_done) {
+            if (rd.load(std::memory_order_acquire)) n++;
+        }
+        return n;
+    }
+
+private:
+
+    std::thread worker;
+
+    void run() {
+
+        // Exceptions can't leave this thread:
+        try {
+            run_reps();
+        } catch (const std::exception& e) {
+            set_error(e.what());
+        } catch (...) {
+            set_error("unknown error in background job");
+        }
+
+        finished.store(true, std::memory_order_release);
+
+        return;
+    }
+
+    void set_error(const std::string& msg) {
+        #ifdef _OPENMP
+        #pragma omp critical
+        #endif
+        {
+            if (error.empty()) error = msg;
+        }
+        cancelled.store(true);
+        return;
+    }
+
+    void run_reps() {
+
+        const uint32_t n_reps = rep_infos.size();
+
+        #ifdef _OPENMP
+        #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+        {
+        #endif
+
+        int status = 0;
+
+        pcg64 eng;
+
+        JobProgress prog_bar(steps_done, cancelled);
+
+        // Dynamic so that finished reps are available in order:
+        #ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+        #endif
+        for (uint32_t i = 0; i < n_reps; i++) {
+            if (status != 0 || cancelled.load()) continue;
+            eng.seed(seeds[i][0], seeds[i][1]);
+            // Exceptions can't leave OpenMP regions or this thread:
+            try {
+                one_quant_gen__<JobProgress>(status,
+                                rep_infos[i], V0, Vp0, N0, f, a0, C, r0, D,
+                                add_var, sigma_V0, sigma_N, sigma_V,
+                                spp_gap_t, final_t, min_N,
+                                save_every, eng, prog_bar);
+            } catch (const std::exception& e) {
+                set_error(e.what());
+                status = -1;
+            } catch (...) {
+                set_error("unknown error in background job");
+                status = -1;
+            }
+            if (status == 0) {
+                prog_bar.finish_rep(steps_per_rep);
+                rep_done[i].store(true, std::memory_order_release);
+            } else prog_bar.reset_rep();
+        }
+
+        #ifdef _OPENMP
+        }
+        #endif
+
+        return;
+    }
+
+};
+
+
+
+
+//' Start quantitative genetics simulations in the background.
+//'
+//' Arguments are the same as for `quant_gen_cpp`.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+SEXP qg_job_start_cpp(const uint32_t& n_reps,
+                      const std::deque<arma::vec>& V0,
+                      const std::deque<arma::vec>& Vp0,
+                      const std::deque<double>& N0,
+                      const double& f,
+                      const double& a0,
+                      const arma::mat& C,
+                      const double& r0,
+                      const arma::mat& D,
+                      const std::deque<double>& add_var,
+                      const double& sigma_V0,
+                      const double& sigma_N,
+                      const std::vector<double>& sigma_V,
+                      const uint32_t& spp_gap_t,
+                      const uint32_t& final_t,
+                      const double& min_N,
+                      const uint32_t& save_every,
+                      const uint32_t& n_threads) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+
+    if (sigma_V0 > 0 && Vp0.size() > 0) {
+        stop("\nproviding Vp0 with sigma_V0 > 0 makes no sense");
+    }
+
+    const uint32_t n = N0.size();
+
+    if (n == 0) stop("n == 0");
+
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+    if (Vp0.size() > 0 && Vp0.size() != n) stop("Vp0.size() != n");
+
+    const uint32_t q = V0[0].n_elem;
+    if (C.n_cols != q) stop("C.n_cols != q");
+    if (C.n_rows != q) stop("C.n_rows != q");
+    if (D.n_cols != q) stop("D.n_cols != q");
+    if (D.n_rows != q) stop("D.n_rows != q");
+    if (sigma_V.size() != q) stop("sigma_V.size() != q");
+
+    // `OneRepInfo` would otherwise check these with `stop` on the job's thread:
+    for (uint32_t i = 0; i < n; i++) {
+        if (V0[i].n_elem != q) stop("\nV0 sizes don't match at index " +
+            std::to_string(i));
+        if (Vp0.size() > 0 && Vp0[i].n_elem != q) {
+            stop("\nVp0 sizes don't match at index " + std::to_string(i));
+        }
+    }
+
+    XPtr<QuantGenJob> job(
+        new QuantGenJob(n_reps, V0, Vp0, N0, f, a0, C, r0, D, add_var,
+                        sigma_V0, sigma_N, sigma_V, spp_gap_t, final_t,
+                        min_N, save_every, n_threads),
+        true);
+
+    job->start();
+
+    return job;
+}
+
+
+//' Status of a background job.
+//'
+//' Returns a list with `status` ("running", "finished", "cancelled",
+//' or "error"), `error` (error message if there was one), `n_done`
+//' (number of finished reps), `n_reps`, and `progress` (proportion of
+//' all time steps done).
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List qg_job_status_cpp(SEXP job_ptr) {
+
+    XPtr<QuantGenJob> job(job_ptr);
+
+    std::string status = "running";
+    std::string error = "";
+    if (job->finished.load(std::memory_order_acquire)) {
+        if (!job->error.empty()) {
+            status = "error";
+            error = job->error;
+        } else if (job->cancelled.load() &&
+            job->n_done() < job->rep_infos.size()) {
+            status = "cancelled";
+        } else status = "finished";
+    } else if (job->cancelled.load()) status = "cancelled";
+
+    double progress = 1;
+    if (job->total_steps > 0) {
+        progress = static_cast<double>(job->steps_done.load()) /
+            static_cast<double>(job->total_steps);
+    }
+
+    List out = List::create(_["status"] = status,
+                            _["error"] = error,
+                            _["n_done"] = job->n_done(),
+                            _["n_reps"] = job->rep_infos.size(),
+                            _["progress"] = progress);
+
+    return out;
+}
+
+
+//' Output from all reps in a background job that have finished.
+//'
+//' Returns a list with `nv` (formatted the same as for `quant_gen_cpp`
+//' output) and `reps` (indexes of reps in `nv`).
+//' This doesn't wait for the job to finish.
+//' If the job stopped with an error, the error is thrown here.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List qg_job_results_cpp(SEXP job_ptr) {
+
+    XPtr<QuantGenJob> job(job_ptr);
+
+    if (job->finished.load(std::memory_order_acquire) && !job->error.empty()) {
+        stop("\nbackground job stopped with an error: " + job->error);
+    }
+
+    const uint32_t n_reps = job->rep_infos.size();
+    const uint32_t q = job->V0.front().n_elem;
+    const bool through_time = job->save_every > 0;
+
+    // Reps that are finished now (more may finish while this is running):
+    std::vector<uint32_t> reps;
+    reps.reserve(n_reps);
+    for (uint32_t i = 0; i < n_reps; i++) {
+        if (job->rep_done[i].load(std::memory_order_acquire)) reps.push_back(i);
+    }
+
+    std::vector<uint32_t> cum_rows(reps.size(), 0);
+    uint32_t n_rows = 0;
+    for (uint32_t k = 0; k < reps.size(); k++) {
+        cum_rows[k] = n_rows;
+        n_rows += job->rep_infos[reps[k]].n_rows(through_time);
+    }
+
+    arma::mat nv(n_rows, (through_time ? 4 : 3) + 2 * q);
+
+    for (uint32_t k = 0; k < reps.size(); k++) {
+        std::vector<double> ids(1, static_cast<double>(reps[k] + 1));
+        job->rep_infos[reps[k]].fill_matrix(nv, ids, cum_rows[k], through_time);
+    }
+
+    IntegerVector rep_ids(reps.size());
+    for (uint32_t k = 0; k < reps.size(); k++) rep_ids[k] = reps[k] + 1;
+
+    List out = List::create(_["nv"] = nv, _["reps"] = rep_ids);
+
+    return out;
+}
+
+
+//' Cancel a background job.
+//'
+//' Reps that have already finished are kept.
+//' If `wait` is `true`, this waits until all threads have stopped.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+void qg_job_cancel_cpp(SEXP job_ptr, const bool& wait) {
+
+    XPtr<QuantGenJob> job(job_ptr);
+
+    job->cancel(wait);
+
+    return;
+}
+
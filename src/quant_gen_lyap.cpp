@@ -0,0 +1,174 @@
+
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <vector>
+#include <deque>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Finite-time Lyapunov exponents along quantitative genetics simulations.
+
+ Orthonormal tangent vectors are multiplied by the Jacobian of every time
+ step and re-orthonormalized using QR decompositions, and the logs of the
+ diagonal of R are summed (see `OneRepInfo::lyap_step`).
+ Only these sums are kept, not the Jacobians themselves.
+ */
+
+
+
+//' Quantitative genetics with finite-time Lyapunov exponents.
+//'
+//' Returns a list with `nv` (formatted the same as `quant_gen_cpp` output
+//' through time) and `lyap`.
+//' `lyap` has one row per rep and saved time, with columns for rep, time,
+//' number of species, number of time steps the exponents are averaged over,
+//' and the leading `n_lyap` exponents.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List quant_gen_lyap_cpp(const uint32_t& n_reps,
+                        const std::deque<arma::vec>& V0,
+                        const std::deque<double>& N0,
+                        const double& f,
+                        const double& a0,
+                        const arma::mat& C,
+                        const double& r0,
+                        const arma::mat& D,
+                        const std::deque<double>& add_var,
+                        const double& sigma_V0,
+                        const double& sigma_N,
+                        const std::vector<double>& sigma_V,
+                        const uint32_t& spp_gap_t,
+                        const uint32_t& final_t,
+                        const double& min_N,
+                        const uint32_t& save_every,
+                        const uint32_t& n_lyap,
+                        const bool& show_progress,
+                        const uint32_t& n_threads) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+
+    const uint32_t n = N0.size();
+
+    if (n == 0) stop("n == 0");
+    if (n_reps == 0) stop("n_reps == 0");
+    if (n_lyap == 0) stop("n_lyap == 0");
+    if (save_every == 0) stop("save_every == 0");
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+
+    const uint32_t q = V0[0].n_elem;
+    if (C.n_rows != q || C.n_cols != q) stop("C is not q x q");
+    if (D.n_rows != q || D.n_cols != q) stop("D is not q x q");
+
+    std::vector<OneRepInfo> rep_infos(n_reps);
+
+    const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_reps);
+
+    Progress prog_bar(static_cast<uint64_t>(n_reps) *
+                      (final_t + (n - 1) * spp_gap_t), show_progress);
+    bool interrupted = false;
+
+    // Starting phenotypes are made inside `one_quant_gen__`:
+    const std::deque<arma::vec> Vp0;
+
+    const TangentOptions tan_opts(n_lyap);
+
+    #ifdef _OPENMP
+    #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+    {
+    #endif
+
+    #ifdef _OPENMP
+    uint32_t active_thread = omp_get_thread_num();
+    #else
+    uint32_t active_thread = 0;
+    #endif
+
+    int status = 0;
+
+    pcg64 eng;
+
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for (uint32_t i = 0; i < n_reps; i++) {
+        eng.seed(seeds[i][0], seeds[i][1]);
+        one_quant_gen__(status,
+                        rep_infos[i], V0, Vp0, N0, f, a0, C, r0, D,
+                        add_var, sigma_V0, sigma_N, sigma_V,
+                        spp_gap_t, final_t, min_N,
+                        save_every, eng, prog_bar, NoiseOptions(), tan_opts);
+
+        if (active_thread == 0 && status != 0) interrupted = true;
+    }
+    #ifdef _OPENMP
+    }
+    #endif
+
+    if (interrupted) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    /*
+     ------------
+     Now organize output:
+     ------------
+     */
+    std::vector<uint32_t> cum_rows(n_reps, 0);
+    std::vector<uint32_t> cum_saves(n_reps, 0);
+    uint32_t n_rows = 0;
+    uint32_t n_saves = 0;
+    for (uint32_t i = 0; i < n_reps; i++) {
+        cum_rows[i] = n_rows;
+        cum_saves[i] = n_saves;
+        n_rows += rep_infos[i].n_rows(true);
+        n_saves += rep_infos[i].t.size();
+    }
+
+    arma::mat nv(n_rows, 4 + 2 * q);
+    arma::mat lyap(n_saves, 4 + n_lyap);
+
+    #ifdef _OPENMP
+    #pragma omp parallel for default(shared) num_threads(n_threads) schedule(static)
+    #endif
+    for (uint32_t i = 0; i < n_reps; i++) {
+        const OneRepInfo& info(rep_infos[i]);
+        std::vector<double> ids(1, static_cast<double>(i + 1));
+        info.fill_matrix(nv, ids, cum_rows[i], true);
+        for (uint32_t k = 0; k < info.t.size(); k++) {
+            const uint32_t r = cum_saves[i] + k;
+            const std::vector<uint32_t>& spp_k(info.spp_t[k]);
+            lyap(r, 0) = i + 1;
+            lyap(r, 1) = info.t[k];
+            // (species of 0 means everything's extinct)
+            lyap(r, 2) = (spp_k.size() == 1 && spp_k[0] == 0) ? 0 : spp_k.size();
+            lyap(r, 3) = info.lyap_steps_t[k];
+            for (uint32_t l = 0; l < n_lyap; l++) {
+                lyap(r, 4 + l) = info.lyap_t[k](l);
+            }
+        }
+    }
+
+    List out = List::create(_["nv"] = nv, _["lyap"] = lyap);
+
+    return out;
+
+}
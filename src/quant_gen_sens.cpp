@@ -0,0 +1,112 @@
+
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <vector>
+#include <deque>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Forward sensitivities of deterministic quantitative genetics.
+
+ Sensitivities of traits and abundances to parameters are propagated
+ alongside the simulation (see `sens_step__` in `quant_gen.cpp`), so one
+ simulation gives both the trajectory and derivatives of the final state
+ with respect to `f`, `a0`, `r0`, `eta`, and `d`.
+ */
+
+
+
+//' Deterministic quantitative genetics with forward sensitivities.
+//'
+//' Returns a list with `nv` (formatted the same as `quant_gen_cpp`
+//' output for one rep) and `sens`.
+//' `sens` has one row per trait and abundance for each surviving species,
+//' with columns for species, state (`0` for abundance, `1` to `q` for
+//' traits), value, and sensitivities to `f`, `a0`, `r0`, `eta`, and `d`.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List quant_gen_sens_cpp(const std::deque<arma::vec>& V0,
+                        const std::deque<double>& N0,
+                        const double& f,
+                        const double& a0,
+                        const arma::mat& C,
+                        const double& r0,
+                        const arma::mat& D,
+                        const arma::mat& dC,
+                        const arma::mat& dD,
+                        const std::deque<double>& add_var,
+                        const uint32_t& spp_gap_t,
+                        const uint32_t& final_t,
+                        const double& min_N,
+                        const uint32_t& save_every,
+                        const bool& show_progress) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+    if (!dC.is_symmetric()) stop("dC must be symmetric");
+    if (!dD.is_symmetric()) stop("dD must be symmetric");
+
+    const uint32_t n = N0.size();
+
+    if (n == 0) stop("n == 0");
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+
+    const uint32_t q = V0[0].n_elem;
+    for (const arma::mat* M : {&C, &D, &dC, &dD}) {
+        if (M->n_rows != q || M->n_cols != q) stop("C, D, dC, or dD not q x q");
+    }
+
+    Progress prog_bar(final_t + (n - 1) * spp_gap_t, show_progress);
+
+    OneRepInfo info;
+    int status = 0;
+    const std::deque<arma::vec> Vp0;
+    const std::vector<double> sigma_V(q, 0.0);
+
+    // Not used for any random numbers since there's no stochasticity:
+    pcg64 eng;
+
+    one_quant_gen__(status, info, V0, Vp0, N0, f, a0, C, r0, D,
+                    add_var, 0.0, 0.0, sigma_V, spp_gap_t, final_t, min_N,
+                    save_every, eng, prog_bar, NoiseOptions(),
+                    TangentOptions(dC, dD));
+
+    if (status != 0) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    const bool through_time = save_every > 0;
+    arma::mat nv(info.n_rows(through_time), (through_time ? 4 : 3) + 2 * q);
+    info.fill_matrix(nv, std::vector<double>(1, 1.0), 0, through_time);
+
+    arma::mat sens(info.N.size() * (q + 1), 8);
+    for (uint32_t i = 0, r = 0; i < info.N.size(); i++) {
+        for (uint32_t j = 0; j <= q; j++, r++) {
+            // abundance first, then traits:
+            const uint32_t k = (j == 0) ? q : j - 1;
+            sens(r, 0) = info.spp[i];
+            sens(r, 1) = j;
+            sens(r, 2) = (j == 0) ? info.N[i] : info.V[i](k);
+            sens(r, arma::span(3, 7)) = info.sens[i].row(k);
+        }
+    }
+
+    List out = List::create(_["nv"] = nv, _["sens"] = sens);
+
+    return out;
+
+}
@@ -0,0 +1,345 @@
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <random>
+#include <vector>
+#include <deque>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Quantitative genetics simulations that persist between calls from R.
+
+ The state of all reps (including their RNGs) is kept in a
+ `QuantGenSession` object that's passed to R as an external pointer.
+ Simulations can then be advanced a bit at a time, have species added,
+ be copied, or have their current state extracted without having to
+ rebuild everything every time.
+ */
+
+
+
+class QuantGenSession {
+public:
+
+    std::vector<OneRepInfo> rep_infos;
+    std::vector<pcg64> engs;            // one RNG per rep
+    std::vector<uint32_t> t;            // time for each rep
+    double f;
+    double a0;
+    arma::mat C;
+    double r0;
+    arma::mat D;
+    double sigma_V0;
+    double sigma_N;
+    std::vector<double> sigma_V;
+    double min_N;
+    uint32_t n_threads;
+    uint32_t q;
+
+    QuantGenSession(const uint32_t& n_reps,
+                    const std::deque<arma::vec>& V0,
+                    const std::deque<double>& N0,
+                    const double& f_,
+                    const double& a0_,
+                    const arma::mat& C_,
+                    const double& r0_,
+                    const arma::mat& D_,
+                    const std::deque<double>& add_var,
+                    const double& sigma_V0_,
+                    const double& sigma_N_,
+                    const std::vector<double>& sigma_V_,
+                    const double& min_N_,
+                    const uint32_t& n_threads_)
+        : rep_infos(n_reps), engs(n_reps), t(n_reps, 0U),
+          f(f_), a0(a0_), C(C_), r0(r0_), D(D_),
+          sigma_V0(sigma_V0_), sigma_N(sigma_N_), sigma_V(sigma_V_),
+          min_N(min_N_), n_threads(n_threads_), q(0) {
+
+        if (!C.is_symmetric()) stop("C must be symmetric");
+        if (!D.is_symmetric()) stop("D must be symmetric");
+
+        const uint32_t n = N0.size();
+
+        if (n == 0) stop("n == 0");
+        if (V0.size() != n) stop("V0.size() != n");
+        if (add_var.size() != n) stop("add_var.size() != n");
+
+        q = V0[0].n_elem;
+        if (C.n_cols != q) stop("C.n_cols != q");
+        if (C.n_rows != q) stop("C.n_rows != q");
+        if (D.n_cols != q) stop("D.n_cols != q");
+        if (D.n_rows != q) stop("D.n_rows != q");
+        if (sigma_V.size() != q) stop("sigma_V.size() != q");
+
+        const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_reps);
+
+        // No progress bar needed for just setting up starting values:
+        Progress prog_bar(0, false);
+        const std::deque<arma::vec> Vp0;
+        int status = 0;
+
+        for (uint32_t i = 0; i < n_reps; i++) {
+            engs[i].seed(seeds[i][0], seeds[i][1]);
+            // All species at once, without any time steps:
+            one_quant_gen__(status,
+                            rep_infos[i], V0, Vp0, N0, f, a0, C, r0, D,
+                            add_var, sigma_V0, sigma_N, sigma_V,
+                            0U, 0U, min_N, 0U, engs[i], prog_bar);
+        }
+
+    }
+
+    /*
+     Advance all reps by `k` time steps.
+     Returns `true` if the user interrupted it.
+     */
+    bool step(const uint32_t& k, const bool& show_progress) {
+
+        const uint32_t n_reps = rep_infos.size();
+
+        Progress prog_bar(n_reps * k, show_progress);
+        bool interrupted = false;
+
+        #ifdef _OPENMP
+        #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+        {
+        #endif
+
+        #ifdef _OPENMP
+        uint32_t active_thread = omp_get_thread_num();
+        #else
+        uint32_t active_thread = 0;
+        #endif
+
+        int status = 0;
+
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for (uint32_t i = 0; i < n_reps; i++) {
+
+            if (status != 0) continue; // previous user interrupt
+
+            OneRepInfo& info(rep_infos[i]);
+            uint32_t interrupt_iters = 0;
+            uint32_t n_pb_incr = 0;
+
+            for (uint32_t j = 0; j < k; j++) {
+                // Extinct reps only have their time updated:
+                if (!info.N.empty()) {
+                    info.iterate(f, a0, C, r0, D, min_N, sigma_N, sigma_V,
+                                 engs[i]);
+                }
+                t[i]++;
+                n_pb_incr++;
+                if (n_pb_incr > 100) {
+                    prog_bar.increment(n_pb_incr);
+                    n_pb_incr = 0;
+                }
+                if (interrupt_check(interrupt_iters, prog_bar, 100)) {
+                    status = -1;
+                    break;
+                }
+            }
+
+            if (n_pb_incr > 0) prog_bar.increment(n_pb_incr);
+
+            if (active_thread == 0 && status != 0) interrupted = true;
+        }
+
+        #ifdef _OPENMP
+        }
+        #endif
+
+        return interrupted;
+    }
+
+    /*
+     Add species with genotypes in the columns of `V` to all reps.
+     Starting genotypes and phenotypes are generated the same way as for
+     species at the start.
+     */
+    void add_species(const arma::mat& V,
+                     const std::vector<double>& N,
+                     const std::vector<double>& add_var) {
+
+        if (V.n_rows != q) stop("V.n_rows != q");
+        if (V.n_cols != N.size()) stop("V.n_cols != N.size()");
+        if (add_var.size() != N.size()) stop("add_var.size() != N.size()");
+
+        normal_distr distr = normal_distr(0, 1);
+
+        for (uint32_t i = 0; i < rep_infos.size(); i++) {
+            pcg64& eng(engs[i]);
+            for (uint32_t k = 0; k < N.size(); k++) {
+                arma::vec V_k = V.col(k);
+                if (sigma_V0 > 0) {
+                    for (uint32_t j = 0; j < q; j++) {
+                        V_k(j) = trunc_rnorm_(V_k(j), sigma_V0, eng);
+                    }
+                }
+                arma::vec Vp_k = V_k;
+                for (uint32_t j = 0; j < q; j++) {
+                    if (sigma_V[j] > 0) {
+                        Vp_k(j) *= std::exp(distr(eng) * sigma_V[j]);
+                    }
+                }
+                rep_infos[i].add_species(N[k], V_k, Vp_k, add_var[k]);
+            }
+        }
+
+        return;
+    }
+
+    /*
+     Current state of all reps, formatted the same as `quant_gen_cpp` output
+     through time.
+     */
+    arma::mat extract() const {
+
+        const uint32_t n_reps = rep_infos.size();
+
+        std::vector<uint32_t> cum_rows(n_reps, 0);
+        uint32_t n_rows = 0;
+        for (uint32_t i = 0; i < n_reps; i++) {
+            cum_rows[i] = n_rows;
+            n_rows += rep_infos[i].n_rows(false);
+        }
+
+        arma::mat nv(n_rows, 4 + 2 * q);
+
+        for (uint32_t i = 0; i < n_reps; i++) {
+            std::vector<double> ids = {static_cast<double>(i + 1),
+                                       static_cast<double>(t[i])};
+            rep_infos[i].fill_matrix(nv, ids, cum_rows[i], false);
+        }
+
+        return nv;
+    }
+
+};
+
+
+
+
+//' Start a persistent quantitative genetics session.
+//'
+//' All species in `V0` and `N0` are added at the start.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+SEXP qg_session_cpp(const uint32_t& n_reps,
+                    const std::deque<arma::vec>& V0,
+                    const std::deque<double>& N0,
+                    const double& f,
+                    const double& a0,
+                    const arma::mat& C,
+                    const double& r0,
+                    const arma::mat& D,
+                    const std::deque<double>& add_var,
+                    const double& sigma_V0,
+                    const double& sigma_N,
+                    const std::vector<double>& sigma_V,
+                    const double& min_N,
+                    const uint32_t& n_threads) {
+
+    XPtr<QuantGenSession> session(
+        new QuantGenSession(n_reps, V0, N0, f, a0, C, r0, D, add_var,
+                            sigma_V0, sigma_N, sigma_V, min_N, n_threads),
+        true);
+
+    return session;
+}
+
+
+//' Advance a session by `k` time steps.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+void qg_session_step_cpp(SEXP session_ptr,
+                         const uint32_t& k,
+                         const bool& show_progress) {
+
+    XPtr<QuantGenSession> session(session_ptr);
+
+    bool interrupted = session->step(k, show_progress);
+
+    if (interrupted) {
+        throw(Rcpp::exception(std::string("\nUser interrupted process. ") +
+            "Reps may now be at different times.", false));
+    }
+
+    return;
+}
+
+
+//' Add species to all reps in a session.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+void qg_session_add_species_cpp(SEXP session_ptr,
+                                const arma::mat& V,
+                                const std::vector<double>& N,
+                                const std::vector<double>& add_var) {
+
+    XPtr<QuantGenSession> session(session_ptr);
+
+    session->add_species(V, N, add_var);
+
+    return;
+}
+
+
+//' Copy a session so the copy can be advanced separately.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+SEXP qg_session_snapshot_cpp(SEXP session_ptr) {
+
+    XPtr<QuantGenSession> session(session_ptr);
+
+    XPtr<QuantGenSession> copy(new QuantGenSession(*session), true);
+
+    return copy;
+}
+
+
+//' Current state of all reps in a session.
+//'
+//' Returns a list with `nv` (formatted the same as output from `quant_gen_cpp`
+//' through time) and `n` (total number of species added).
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List qg_session_extract_cpp(SEXP session_ptr) {
+
+    XPtr<QuantGenSession> session(session_ptr);
+
+    uint32_t n = 0;
+    if (!session->rep_infos.empty()) n = session->rep_infos.front().n;
+
+    List out = List::create(_["nv"] = session->extract(),
+                            _["n"] = n);
+
+    return out;
+}
+
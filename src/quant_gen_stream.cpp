@@ -0,0 +1,142 @@
+
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <vector>
+#include <deque>
+#include <string>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+#include "traj_io.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Quantitative genetics with trajectories streamed to a file.
+
+ Each thread has one bounded `TrajBuffer` that all its reps write saved
+ times to, and full buffers are written to the shared `TrajFile` as chunks.
+ Peak memory is then a few buffers, regardless of how long simulations run.
+ */
+
+
+
+//' Multiple repetitions of quantitative genetics, streaming output to a file.
+//'
+//' Output is written to `file` (see `traj_io.hpp` for its format), and
+//' the number of rows written is returned.
+//' If `float32` is true, genotypes and phenotypes are written as floats.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+double quant_gen_stream_cpp(const std::string& file,
+                            const uint32_t& n_reps,
+                            const std::deque<arma::vec>& V0,
+                            const std::deque<double>& N0,
+                            const double& f,
+                            const double& a0,
+                            const arma::mat& C,
+                            const double& r0,
+                            const arma::mat& D,
+                            const std::deque<double>& add_var,
+                            const double& sigma_V0,
+                            const double& sigma_N,
+                            const std::vector<double>& sigma_V,
+                            const uint32_t& spp_gap_t,
+                            const uint32_t& final_t,
+                            const double& min_N,
+                            const uint32_t& save_every,
+                            const bool& show_progress,
+                            const uint32_t& n_threads,
+                            const bool& float32) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+
+    const uint32_t n = N0.size();
+
+    if (n == 0) stop("n == 0");
+    if (n_reps == 0) stop("n_reps == 0");
+    if (save_every == 0) stop("save_every == 0");
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+
+    const uint32_t q = V0[0].n_elem;
+    if (C.n_rows != q || C.n_cols != q) stop("C is not q x q");
+    if (D.n_rows != q || D.n_cols != q) stop("D is not q x q");
+
+    bool pheno = false;
+    for (const double& sv : sigma_V) pheno = pheno || sv > 0;
+
+    TrajFile traj_file(file, q, n, pheno, float32);
+
+    const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_reps);
+
+    Progress prog_bar(static_cast<uint64_t>(n_reps) *
+                      (final_t + (n - 1) * spp_gap_t), show_progress);
+    bool interrupted = false;
+
+    // Starting phenotypes are made inside `one_quant_gen__`:
+    const std::deque<arma::vec> Vp0;
+
+    #ifdef _OPENMP
+    #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+    {
+    #endif
+
+    #ifdef _OPENMP
+    uint32_t active_thread = omp_get_thread_num();
+    #else
+    uint32_t active_thread = 0;
+    #endif
+
+    int status = 0;
+
+    pcg64 eng;
+
+    // Written to the file when full and when it goes out of scope:
+    TrajBuffer buf(traj_file);
+
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for (uint32_t i = 0; i < n_reps; i++) {
+        // Only the current state is kept for each rep:
+        OneRepInfo info;
+        eng.seed(seeds[i][0], seeds[i][1]);
+        one_quant_gen__(status,
+                        info, V0, Vp0, N0, f, a0, C, r0, D,
+                        add_var, sigma_V0, sigma_N, sigma_V,
+                        spp_gap_t, final_t, min_N,
+                        save_every, eng, prog_bar, NoiseOptions(),
+                        TangentOptions(), SummaryOptions(),
+                        StreamOptions(&buf, i + 1));
+
+        if (active_thread == 0 && status != 0) interrupted = true;
+    }
+
+    #ifdef _OPENMP
+    }
+    #endif
+
+    if (interrupted) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    if (!traj_file.close()) stop("\nError writing to file: " + file);
+
+    return static_cast<double>(traj_file.n_rows);
+
+}
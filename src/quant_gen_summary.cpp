@@ -0,0 +1,152 @@
+
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <vector>
+#include <deque>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Summary-only output for quantitative genetics.
+
+ Instead of saving trajectories, each rep keeps one summary per species
+ (see `SppSummary` in `quant_gen.hpp`) that's updated every time step.
+ Output size then depends only on the number of reps and species, not on
+ the number of time steps.
+ */
+
+
+
+//' Multiple repetitions of quantitative genetics, only returning summaries.
+//'
+//' Returns a matrix with one row per rep and species, with columns for
+//' rep, species, time added, time of extinction, number of time steps in
+//' the final window it was present for, mean and variance of abundance,
+//' means of genotypes (`q` columns), and variances of genotypes
+//' (`q` columns).
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+arma::mat quant_gen_summary_cpp(const uint32_t& n_reps,
+                                const std::deque<arma::vec>& V0,
+                                const std::deque<double>& N0,
+                                const double& f,
+                                const double& a0,
+                                const arma::mat& C,
+                                const double& r0,
+                                const arma::mat& D,
+                                const std::deque<double>& add_var,
+                                const double& sigma_V0,
+                                const double& sigma_N,
+                                const std::vector<double>& sigma_V,
+                                const uint32_t& spp_gap_t,
+                                const uint32_t& final_t,
+                                const double& min_N,
+                                const uint32_t& window,
+                                const bool& show_progress,
+                                const uint32_t& n_threads) {
+
+    if (!C.is_symmetric()) stop("C must be symmetric");
+    if (!D.is_symmetric()) stop("D must be symmetric");
+
+    const uint32_t n = N0.size();
+
+    if (n == 0) stop("n == 0");
+    if (n_reps == 0) stop("n_reps == 0");
+    if (window == 0) stop("window == 0");
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+
+    const uint32_t q = V0[0].n_elem;
+    if (C.n_rows != q || C.n_cols != q) stop("C is not q x q");
+    if (D.n_rows != q || D.n_cols != q) stop("D is not q x q");
+
+    std::vector<OneRepInfo> rep_infos(n_reps);
+
+    const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_reps);
+
+    Progress prog_bar(static_cast<uint64_t>(n_reps) *
+                      (final_t + (n - 1) * spp_gap_t), show_progress);
+    bool interrupted = false;
+
+    // Starting phenotypes are made inside `one_quant_gen__`:
+    const std::deque<arma::vec> Vp0;
+
+    const SummaryOptions summ_opts(window);
+
+    #ifdef _OPENMP
+    #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+    {
+    #endif
+
+    #ifdef _OPENMP
+    uint32_t active_thread = omp_get_thread_num();
+    #else
+    uint32_t active_thread = 0;
+    #endif
+
+    int status = 0;
+
+    pcg64 eng;
+
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for (uint32_t i = 0; i < n_reps; i++) {
+        eng.seed(seeds[i][0], seeds[i][1]);
+        // `save_every = 0` so no trajectories are saved:
+        one_quant_gen__(status,
+                        rep_infos[i], V0, Vp0, N0, f, a0, C, r0, D,
+                        add_var, sigma_V0, sigma_N, sigma_V,
+                        spp_gap_t, final_t, min_N,
+                        0U, eng, prog_bar, NoiseOptions(), TangentOptions(),
+                        summ_opts);
+
+        if (active_thread == 0 && status != 0) interrupted = true;
+    }
+    #ifdef _OPENMP
+    }
+    #endif
+
+    if (interrupted) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    arma::mat summ(n_reps * n, 7 + 2 * q);
+
+    for (uint32_t i = 0; i < n_reps; i++) {
+        for (uint32_t k = 0; k < n; k++) {
+            const SppSummary& s(rep_infos[i].summ[k]);
+            const uint32_t r = i * n + k;
+            summ(r, 0) = i + 1;
+            summ(r, 1) = k + 1;
+            summ(r, 2) = s.added;
+            summ(r, 3) = s.extinct;
+            summ(r, 4) = s.N.n;
+            summ(r, 5) = (s.N.n > 0) ? s.N.mean : arma::datum::nan;
+            summ(r, 6) = s.N.var();
+            for (uint32_t j = 0; j < q; j++) {
+                summ(r, 7 + j) = (s.V[j].n > 0) ? s.V[j].mean : arma::datum::nan;
+                summ(r, 7 + q + j) = s.V[j].var();
+            }
+        }
+    }
+
+    return summ;
+
+}
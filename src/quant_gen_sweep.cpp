@@ -0,0 +1,292 @@
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <random>
+#include <vector>
+#include <deque>
+#include <atomic>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Quantitative genetics for many scenarios (i.e., parameter combinations)
+ in one call.
+
+ Every (scenario, rep) pair goes into one work queue that all threads
+ take from, so threads stay busy even when scenarios differ in number
+ of reps or in how long reps take.
+ The thread that finishes a scenario's last rep puts that scenario's output
+ matrix together and frees its reps, so full output is only kept for
+ scenarios that are still running.
+ (Matrices can't be passed to R until all threads are done, since the R API
+ can't be used on other threads.)
+ */
+
+
+
+/*
+ Inputs for one scenario.
+ */
+struct QuantGenScenario {
+    std::deque<arma::vec> V0;
+    std::deque<double> N0;
+    double f;
+    double a0;
+    arma::mat C;
+    double r0;
+    arma::mat D;
+    std::deque<double> add_var;
+    double sigma_V0;
+    double sigma_N;
+    std::vector<double> sigma_V;
+    uint32_t n_sims;        // # reps actually simulated
+    uint32_t rep_copies;    // # reps each simulated rep stands for
+};
+
+
+
+
+//' Multiple repetitions of quantitative genetics for multiple scenarios.
+//'
+//' All arguments except the last eight have one item per scenario.
+//' If `common_noise` is true, rep k in every scenario uses the same seed.
+//' If `antithetic` is true, reps are paired within each scenario, and the
+//' second rep in each pair uses the same seed as the first but with all
+//' noise negated.
+//' Both of these use separate noise streams for each species
+//' (see `NoiseOptions` in `quant_gen.hpp`).
+//' `V0` items are matrices with one column per species.
+//' As in `quant_gen_cpp`, only one rep is simulated for scenarios without
+//' stochasticity.
+//'
+//' Returns a list with `nv` (a list of matrices, one per scenario, formatted
+//' the same as for `quant_gen_cpp`) and `rep_copies`.
+//' Each scenario's matrix is made as soon as all its reps are done.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List quant_gen_sweep_cpp(const std::vector<uint32_t>& n_reps,
+                         const std::vector<arma::mat>& V0,
+                         const std::vector<std::vector<double>>& N0,
+                         const std::vector<double>& f,
+                         const std::vector<double>& a0,
+                         const std::vector<arma::mat>& C,
+                         const std::vector<double>& r0,
+                         const std::vector<arma::mat>& D,
+                         const std::vector<std::vector<double>>& add_var,
+                         const std::vector<double>& sigma_V0,
+                         const std::vector<double>& sigma_N,
+                         const std::vector<std::vector<double>>& sigma_V,
+                         const uint32_t& spp_gap_t,
+                         const uint32_t& final_t,
+                         const double& min_N,
+                         const uint32_t& save_every,
+                         const bool& common_noise,
+                         const bool& antithetic,
+                         const bool& show_progress,
+                         const uint32_t& n_threads) {
+
+    const uint32_t n_scen = n_reps.size();
+
+    if (n_scen == 0) stop("n_scen == 0");
+    if (V0.size() != n_scen) stop("V0.size() != n_scen");
+    if (N0.size() != n_scen) stop("N0.size() != n_scen");
+    if (f.size() != n_scen) stop("f.size() != n_scen");
+    if (a0.size() != n_scen) stop("a0.size() != n_scen");
+    if (C.size() != n_scen) stop("C.size() != n_scen");
+    if (r0.size() != n_scen) stop("r0.size() != n_scen");
+    if (D.size() != n_scen) stop("D.size() != n_scen");
+    if (add_var.size() != n_scen) stop("add_var.size() != n_scen");
+    if (sigma_V0.size() != n_scen) stop("sigma_V0.size() != n_scen");
+    if (sigma_N.size() != n_scen) stop("sigma_N.size() != n_scen");
+    if (sigma_V.size() != n_scen) stop("sigma_V.size() != n_scen");
+
+    std::vector<QuantGenScenario> scens(n_scen);
+    // Index of the first task for each scenario:
+    std::vector<uint32_t> first_task(n_scen + 1, 0);
+    uint64_t total_steps = 0;
+
+    for (uint32_t s = 0; s < n_scen; s++) {
+
+        std::string s_str = std::string(" in scenario ") + std::to_string(s + 1);
+
+        if (!C[s].is_symmetric()) stop("C must be symmetric" + s_str);
+        if (!D[s].is_symmetric()) stop("D must be symmetric" + s_str);
+
+        const uint32_t n = N0[s].size();
+        const uint32_t q = V0[s].n_rows;
+
+        if (n == 0) stop("n == 0" + s_str);
+        if (V0[s].n_cols != n) stop("V0.n_cols != n" + s_str);
+        if (add_var[s].size() != n) stop("add_var.size() != n" + s_str);
+        if (C[s].n_cols != q || C[s].n_rows != q) stop("C is not q x q" + s_str);
+        if (D[s].n_cols != q || D[s].n_rows != q) stop("D is not q x q" + s_str);
+        if (sigma_V[s].size() != q) stop("sigma_V.size() != q" + s_str);
+
+        QuantGenScenario& scen(scens[s]);
+        for (uint32_t j = 0; j < n; j++) scen.V0.push_back(V0[s].col(j));
+        scen.N0.assign(N0[s].begin(), N0[s].end());
+        scen.f = f[s];
+        scen.a0 = a0[s];
+        scen.C = C[s];
+        scen.r0 = r0[s];
+        scen.D = D[s];
+        scen.add_var.assign(add_var[s].begin(), add_var[s].end());
+        scen.sigma_V0 = sigma_V0[s];
+        scen.sigma_N = sigma_N[s];
+        scen.sigma_V = sigma_V[s];
+
+        bool deterministic = sigma_V0[s] <= 0 && sigma_N[s] <= 0;
+        for (const double& sv : sigma_V[s]) {
+            deterministic = deterministic && sv <= 0;
+        }
+        scen.n_sims = deterministic ? std::min(n_reps[s], 1U) : n_reps[s];
+        scen.rep_copies = deterministic ? n_reps[s] : 1U;
+
+        first_task[s+1] = first_task[s] + scen.n_sims;
+        total_steps += static_cast<uint64_t>(scen.n_sims) *
+            (final_t + (n - 1) * spp_gap_t);
+    }
+
+    const uint32_t n_tasks = first_task.back();
+
+    // Which scenario and rep each task is for:
+    std::vector<uint32_t> task_scen(n_tasks);
+    std::vector<uint32_t> task_rep(n_tasks);
+    for (uint32_t s = 0; s < n_scen; s++) {
+        for (uint32_t i = first_task[s]; i < first_task[s+1]; i++) {
+            task_scen[i] = s;
+            task_rep[i] = i - first_task[s];
+        }
+    }
+
+    /*
+     Which seed each task uses, and whether its noise is negated.
+     Without `common_noise` or `antithetic`, each task gets its own seed.
+     */
+    std::vector<uint32_t> task_seed(n_tasks);
+    std::vector<bool> task_anti(n_tasks, false);
+    uint32_t n_seeds = 0;
+    for (uint32_t s = 0; s < n_scen; s++) {
+        uint32_t first_seed = common_noise ? 0 : n_seeds;
+        for (uint32_t i = first_task[s]; i < first_task[s+1]; i++) {
+            uint32_t k = task_rep[i];
+            if (antithetic) {
+                task_anti[i] = (k % 2) == 1;
+                k /= 2;
+            }
+            task_seed[i] = first_seed + k;
+            if (task_seed[i] >= n_seeds) n_seeds = task_seed[i] + 1;
+        }
+    }
+
+    std::vector<OneRepInfo> rep_infos(n_tasks);
+
+    const std::vector<std::vector<uint128_t>> seeds = mc_seeds_rep(n_seeds);
+
+    Progress prog_bar(total_steps, show_progress);
+    bool interrupted = false;
+
+    // Starting phenotypes are made inside `one_quant_gen__`:
+    const std::deque<arma::vec> Vp0;
+
+    const bool through_time = save_every > 0;
+
+    // Output, one matrix per scenario:
+    std::vector<arma::mat> nv(n_scen);
+    // Number of reps in each scenario that aren't done yet:
+    std::vector<std::atomic<uint32_t>> tasks_left(n_scen);
+    for (uint32_t s = 0; s < n_scen; s++) {
+        tasks_left[s].store(scens[s].n_sims);
+        if (scens[s].n_sims == 0) {
+            nv[s].set_size(0, (through_time ? 4 : 3) + 2 * V0[s].n_rows);
+        }
+    }
+
+    // Fill the matrix for a scenario whose reps are all done, then free reps:
+    auto fill_scenario = [&](const uint32_t& s) {
+        uint32_t n_rows = 0;
+        for (uint32_t i = first_task[s]; i < first_task[s+1]; i++) {
+            n_rows += rep_infos[i].n_rows(through_time);
+        }
+        nv[s].set_size(n_rows, (through_time ? 4 : 3) + 2 * V0[s].n_rows);
+        uint32_t start_row = 0;
+        for (uint32_t i = first_task[s]; i < first_task[s+1]; i++) {
+            std::vector<double> ids(1, static_cast<double>(task_rep[i] + 1));
+            rep_infos[i].fill_matrix(nv[s], ids, start_row, through_time);
+            start_row += rep_infos[i].n_rows(through_time);
+            rep_infos[i] = OneRepInfo();
+        }
+        return;
+    };
+
+    #ifdef _OPENMP
+    #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+    {
+    #endif
+
+    #ifdef _OPENMP
+    uint32_t active_thread = omp_get_thread_num();
+    #else
+    uint32_t active_thread = 0;
+    #endif
+
+    int status = 0;
+
+    pcg64 eng;
+
+    // Dynamic scheduling so that all tasks come from one queue:
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for (uint32_t i = 0; i < n_tasks; i++) {
+        const QuantGenScenario& scen(scens[task_scen[i]]);
+        const std::vector<uint128_t>& seed(seeds[task_seed[i]]);
+        eng.seed(seed[0], seed[1]);
+        NoiseOptions noise_opts(common_noise || antithetic, task_anti[i]);
+        one_quant_gen__(status,
+                        rep_infos[i], scen.V0, Vp0, scen.N0,
+                        scen.f, scen.a0, scen.C, scen.r0, scen.D,
+                        scen.add_var, scen.sigma_V0, scen.sigma_N,
+                        scen.sigma_V, spp_gap_t, final_t, min_N,
+                        save_every, eng, prog_bar, noise_opts);
+
+        if (active_thread == 0 && status != 0) interrupted = true;
+
+        // Only one thread sees the count reach zero for each scenario:
+        if (status == 0 && tasks_left[task_scen[i]].fetch_sub(1) == 1) {
+            fill_scenario(task_scen[i]);
+        }
+    }
+    #ifdef _OPENMP
+    }
+    #endif
+
+    if (interrupted) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    std::vector<uint32_t> rep_copies(n_scen);
+    for (uint32_t s = 0; s < n_scen; s++) rep_copies[s] = scens[s].rep_copies;
+
+    List out = List::create(_["nv"] = nv,
+                            _["rep_copies"] = rep_copies);
+
+    return out;
+
+}
+
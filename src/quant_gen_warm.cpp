@@ -0,0 +1,288 @@
+
+
+
+#include <RcppArmadillo.h>
+#include <progress.hpp>
+#include <progress_bar.hpp>
+#include <vector>
+#include <deque>
+
+#include "sim.hpp"
+#include "pcg.hpp"
+#include "quant_gen.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>  // omp
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Warm-started sweeps of deterministic quantitative genetics.
+
+ Grid cells are visited in an order where consecutive cells are neighbors,
+ and each cell starts from the converged community of the cell before it.
+ Since neighboring cells usually have very similar equilibria, this takes
+ far fewer time steps than starting every cell from `V0`.
+ The walk is split into chains that run in parallel, and the first cell in
+ each chain has a cold start (i.e., from `V0`, with species added as in
+ `quant_gen`).
+ */
+
+
+
+/*
+ Iterate until the community stops changing (or goes extinct), checking
+ every `check_every` time steps, or until `max_t` time steps.
+ `steps` is set to the number of time steps taken.
+ */
+void converge_quant_gen__(int& status,
+                          uint32_t& steps,
+                          bool& converged,
+                          OneRepInfo& info,
+                          const double& f,
+                          const double& a0,
+                          const arma::mat& C,
+                          const double& r0,
+                          const arma::mat& D,
+                          const uint32_t& max_t,
+                          const double& min_N,
+                          const uint32_t& check_every,
+                          const double& conv_tol,
+                          pcg64& eng,
+                          Progress& prog_bar) {
+
+    steps = 0;
+    converged = false;
+
+    if (status != 0) return; // previous user interrupt
+
+    const std::vector<double> sigma_V(C.n_rows, 0.0);
+
+    uint32_t t = 0;
+    uint32_t interrupt_iters = 0;   // checking for user interrupt
+    uint32_t n_pb_incr = 0;         // progress bar increments
+
+    std::vector<double> N_last = info.N;
+    std::vector<arma::vec> V_last = info.V;
+    std::vector<uint32_t> spp_last = info.spp;
+
+    while (t < max_t) {
+
+        // Total extinction can't change:
+        if (info.N.empty()) {
+            converged = true;
+            break;
+        }
+
+        if (t > 0 && t % check_every == 0) {
+            if (has_converged(info, N_last, V_last, spp_last, conv_tol)) {
+                converged = true;
+                break;
+            }
+            N_last = info.N;
+            V_last = info.V;
+            spp_last = info.spp;
+        }
+
+        n_pb_incr++;
+
+        info.iterate(f, a0, C, r0, D, min_N, 0.0, sigma_V, eng);
+
+        if (n_pb_incr > 100) {
+            prog_bar.increment(n_pb_incr);
+            n_pb_incr = 0;
+        }
+
+        t++;
+
+        // Check for user interrupt:
+        if (interrupt_check(interrupt_iters, prog_bar, 100)) {
+            status = -1;
+            return;
+        }
+
+    }
+
+    steps = t;
+
+    // Count skipped time steps as done for the progress bar:
+    n_pb_incr += (max_t - t);
+    if (n_pb_incr > 0) prog_bar.increment(n_pb_incr);
+
+    return;
+}
+
+
+
+
+//' Warm-started sweep of deterministic quantitative genetics.
+//'
+//' `C`, `D`, `f`, `a0`, and `r0` have one item per grid cell.
+//' `walk` is the order (0-based cell indexes) to visit cells in, and it's
+//' split into `n_chains` chains of consecutive cells.
+//'
+//' Returns a list with `nv` (final values, formatted the same as
+//' `quant_gen_cpp` with `save_every = 0`, with cell index instead of rep),
+//' `cold`, `steps`, and `converged` (one item per cell).
+//' For cold starts, `steps` includes time steps while species were added.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List quant_gen_warm_cpp(const std::vector<uint32_t>& walk,
+                        const uint32_t& n_chains,
+                        const std::deque<arma::vec>& V0,
+                        const std::deque<double>& N0,
+                        const std::deque<double>& add_var,
+                        const std::vector<arma::mat>& C,
+                        const std::vector<arma::mat>& D,
+                        const std::vector<double>& f,
+                        const std::vector<double>& a0,
+                        const std::vector<double>& r0,
+                        const uint32_t& spp_gap_t,
+                        const uint32_t& max_t,
+                        const double& min_N,
+                        const uint32_t& check_every,
+                        const double& conv_tol,
+                        const bool& show_progress,
+                        const uint32_t& n_threads) {
+
+    const uint32_t n_cells = walk.size();
+    const uint32_t n = N0.size();
+
+    if (n_cells == 0) stop("n_cells == 0");
+    if (n_chains == 0 || n_chains > n_cells) stop("n_chains not in 1:n_cells");
+    if (n == 0) stop("n == 0");
+    if (check_every == 0) stop("check_every == 0");
+    if (V0.size() != n) stop("V0.size() != n");
+    if (add_var.size() != n) stop("add_var.size() != n");
+    if (C.size() != n_cells) stop("C.size() != n_cells");
+    if (D.size() != n_cells) stop("D.size() != n_cells");
+    if (f.size() != n_cells) stop("f.size() != n_cells");
+    if (a0.size() != n_cells) stop("a0.size() != n_cells");
+    if (r0.size() != n_cells) stop("r0.size() != n_cells");
+
+    const uint32_t q = V0[0].n_elem;
+    for (uint32_t i = 0; i < n_cells; i++) {
+        if (walk[i] >= n_cells) stop("walk has index >= n_cells");
+        if (!C[i].is_symmetric()) stop("C must be symmetric");
+        if (!D[i].is_symmetric()) stop("D must be symmetric");
+        if (C[i].n_rows != q || C[i].n_cols != q) stop("C is not q x q");
+        if (D[i].n_rows != q || D[i].n_cols != q) stop("D is not q x q");
+    }
+
+    std::vector<OneRepInfo> cell_infos(n_cells);
+    std::vector<int> cold(n_cells, 0);
+    std::vector<int> steps(n_cells, 0);
+    std::vector<int> converged(n_cells, 0);
+
+    // First position in `walk` for each chain:
+    std::vector<uint32_t> chain_start(n_chains + 1);
+    for (uint32_t c = 0; c <= n_chains; c++) {
+        chain_start[c] = static_cast<uint32_t>(
+            (static_cast<uint64_t>(c) * n_cells) / n_chains);
+    }
+
+    // Upper bound; cold starts also include species additions:
+    Progress prog_bar(static_cast<uint64_t>(n_cells) * max_t +
+                      static_cast<uint64_t>(n_chains) * (n - 1) * spp_gap_t,
+                      show_progress);
+    bool interrupted = false;
+
+    const std::deque<arma::vec> Vp0;
+    const std::vector<double> sigma_V(q, 0.0);
+
+    #ifdef _OPENMP
+    #pragma omp parallel default(shared) num_threads(n_threads) if (n_threads > 1)
+    {
+    #endif
+
+    #ifdef _OPENMP
+    uint32_t active_thread = omp_get_thread_num();
+    #else
+    uint32_t active_thread = 0;
+    #endif
+
+    int status = 0;
+
+    // Not used for any random numbers since there's no stochasticity:
+    pcg64 eng;
+
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+    #endif
+    for (uint32_t c = 0; c < n_chains; c++) {
+
+        for (uint32_t k = chain_start[c]; k < chain_start[c+1]; k++) {
+
+            const uint32_t i = walk[k];
+            const uint32_t prev = (k > chain_start[c]) ? walk[k-1] : 0;
+            OneRepInfo& info(cell_infos[i]);
+
+            // Can't warm start from total extinction:
+            if (k == chain_start[c] || cell_infos[prev].N.empty()) {
+                cold[i] = 1;
+                one_quant_gen__(status, info, V0, Vp0, N0,
+                                f[i], a0[i], C[i], r0[i], D[i],
+                                add_var, 0.0, 0.0, sigma_V,
+                                spp_gap_t, 0U, min_N, 0U, eng, prog_bar);
+            } else info = cell_infos[prev];
+
+            uint32_t steps_i = 0;
+            bool conv_i = false;
+            converge_quant_gen__(status, steps_i, conv_i, info,
+                                 f[i], a0[i], C[i], r0[i], D[i],
+                                 max_t, min_N, check_every, conv_tol,
+                                 eng, prog_bar);
+            if (cold[i]) steps_i += (n - 1) * spp_gap_t;
+            steps[i] = steps_i;
+            converged[i] = conv_i;
+
+            if (status != 0) break;
+        }
+
+        if (active_thread == 0 && status != 0) interrupted = true;
+    }
+    #ifdef _OPENMP
+    }
+    #endif
+
+    if (interrupted) {
+        throw(Rcpp::exception("\nUser interrupted process.", false));
+    }
+
+    /*
+     ------------
+     Now organize output, in the original order of cells:
+     ------------
+     */
+    std::vector<uint32_t> cum_rows(n_cells, 0);
+    uint32_t n_rows = 0;
+    for (uint32_t i = 0; i < n_cells; i++) {
+        cum_rows[i] = n_rows;
+        n_rows += cell_infos[i].n_rows(false);
+    }
+
+    arma::mat nv(n_rows, 3 + 2 * q);
+
+    #ifdef _OPENMP
+    #pragma omp parallel for default(shared) num_threads(n_threads) schedule(static)
+    #endif
+    for (uint32_t i = 0; i < n_cells; i++) {
+        std::vector<double> ids(1, static_cast<double>(i + 1));
+        cell_infos[i].fill_matrix(nv, ids, cum_rows[i], false);
+    }
+
+    List out = List::create(_["nv"] = nv,
+                            _["cold"] = LogicalVector(cold.begin(), cold.end()),
+                            _["steps"] = steps,
+                            _["converged"] = LogicalVector(converged.begin(),
+                                                           converged.end()));
+
+    return out;
+
+}
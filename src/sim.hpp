@@ -9,6 +9,7 @@
 #include <RcppArmadillo.h>
 #include <progress.hpp>
 #include <progress_bar.hpp>
+#include <chrono>
 #include "pcg.hpp"
 
 using namespace Rcpp;
@@ -17,8 +18,9 @@ using namespace Rcpp;
 
 
 // For checking for user interrupts every N iterations:
+template <typename P>
 inline bool interrupt_check(uint32_t& iters,
-                            Progress& prog_bar,
+                            P& prog_bar,
                             const uint32_t& N) {
     ++iters;
     if (iters > N) {
@@ -29,6 +31,44 @@ inline bool interrupt_check(uint32_t& iters,
 }
 
 
+/*
+ Wraps a progress bar so that it's also aborted after a wall-clock deadline.
+ Use one per thread.
+ */
+template <typename P>
+class DeadlineProgress {
+public:
+
+    typedef std::chrono::steady_clock clock;
+
+    DeadlineProgress(P& prog_bar_,
+                     const bool& has_deadline_,
+                     const clock::time_point& deadline_)
+        : prog_bar(prog_bar_), has_deadline(has_deadline_),
+          deadline(deadline_) {};
+
+    void increment(unsigned long n = 1) {
+        prog_bar.increment(n);
+        return;
+    }
+    bool is_aborted() const {
+        return prog_bar.is_aborted() || past_deadline();
+    }
+    bool check_abort() {
+        return past_deadline() || prog_bar.check_abort();
+    }
+    bool past_deadline() const {
+        return has_deadline && clock::now() >= deadline;
+    }
+
+private:
+    P& prog_bar;
+    const bool has_deadline;
+    const clock::time_point deadline;
+};
+
+
+
 //' Normal distribution truncated above zero.
 //'
 //' @noRd
@@ -46,6 +86,24 @@ inline double trunc_rnorm_(const double& mu, const double& sigma, pcg64& eng) {
     return x;
 }
 
+//' Same as above, but using a uniform deviate in (0,1) that's already drawn.
+//'
+//' @noRd
+//'
+inline double trunc_rnorm_u_(const double& mu, const double& sigma,
+                             const double& u01) {
+
+    double a_bar = (0 - mu) / sigma;
+
+    double p = R::pnorm5(a_bar, 0, 1, 1, 0);
+    double u = p + (1 - p) * u01;
+
+    double x = R::qnorm5(u, 0, 1, 1, 0);
+    x = x * sigma + mu;
+
+    return x;
+}
+
 //' Same as above, but using R's RNG.
 //'
 //' Used in `trunc_rnorm_cpp` only, for testing.
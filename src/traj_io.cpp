@@ -0,0 +1,875 @@
+
+
+
+#include <RcppArmadillo.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <climits>
+
+#ifdef _WIN32
+#include <stdio.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "traj_io.hpp"
+#include "lazy_col.hpp"
+
+// Lazy trajectory columns also need a memory-mapped file:
+#if defined(SAURON_ALTREP) && !defined(_WIN32)
+#define SAURON_TRAJ_ALTREP
+#endif
+
+
+using namespace Rcpp;
+
+
+
+/*
+ Reading trajectory files written by `TrajFile`, and making and reading
+ indexed trajectory files (see `traj_io.hpp` for both formats).
+ */
+
+
+namespace traj_io {
+
+// Seeking that works past 2 GB:
+inline int seek64(std::FILE* fp, const int64_t& offset, const int& whence) {
+#ifdef _WIN32
+    return _fseeki64(fp, offset, whence);
+#else
+    return fseeko(fp, static_cast<off_t>(offset), whence);
+#endif
+}
+inline int64_t tell64(std::FILE* fp) {
+#ifdef _WIN32
+    return _ftelli64(fp);
+#else
+    return static_cast<int64_t>(ftello(fp));
+#endif
+}
+
+// Closes the file when it goes out of scope, including from `stop`:
+class File {
+public:
+    std::FILE* fp;
+    File(const std::string& path, const char* mode = "rb")
+        : fp(std::fopen(path.c_str(), mode)) {
+        if (fp == NULL) stop("\nCan't open file: " + path);
+    }
+    ~File() {
+        if (fp != NULL) std::fclose(fp);
+    }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    // Returns false if the end of the file is reached first:
+    inline bool read(void* x, const size_t& size, const size_t& count) {
+        if (count == 0) return true;
+        return std::fread(x, size, count, fp) == count;
+    }
+    inline bool write(const void* x, const size_t& size, const size_t& count) {
+        if (count == 0) return true;
+        return std::fwrite(x, size, count, fp) == count;
+    }
+    inline bool skip(const uint64_t& bytes) {
+        return seek64(fp, static_cast<int64_t>(bytes), SEEK_CUR) == 0;
+    }
+};
+
+
+/*
+ Columns are rep, time, species (all uint32), N (double), then traits
+ (double, or float if `float32` is true).
+ */
+inline uint64_t col_bytes(const uint32_t& c, const bool& float32) {
+    if (c < 3) return sizeof(uint32_t);
+    if (c == 3 || !float32) return sizeof(double);
+    return sizeof(float);
+}
+// Value of item `k` in raw column `c`:
+inline double col_value(const char* x, const uint64_t& k,
+                        const uint32_t& c, const bool& float32) {
+    if (c < 3) {
+        uint32_t v;
+        std::memcpy(&v, x + k * sizeof(uint32_t), sizeof(uint32_t));
+        return static_cast<double>(v);
+    }
+    if (c == 3 || !float32) {
+        double v;
+        std::memcpy(&v, x + k * sizeof(double), sizeof(double));
+        return v;
+    }
+    float v;
+    std::memcpy(&v, x + k * sizeof(float), sizeof(float));
+    return static_cast<double>(v);
+}
+
+
+// Info from the header of a streamed trajectory file:
+struct StreamHeader {
+    uint32_t q;
+    uint32_t n;
+    bool pheno;
+    bool float32;
+    int64_t data_start;     // where chunks start
+    uint64_t row_bytes;     // bytes per row
+
+    StreamHeader(File& in, const std::string& file) {
+        char magic[8];
+        uint32_t header[4];
+        if (!in.read(magic, 1, 8) ||
+            std::memcmp(magic, TRAJ_MAGIC, 8) != 0 ||
+            !in.read(header, sizeof(uint32_t), 4)) {
+            stop("\nNot a trajectory file: " + file);
+        }
+        if (header[0] == 0 || header[0] > TRAJ_VERSION) {
+            stop("\nUnknown trajectory file version: " +
+                std::to_string(header[0]));
+        }
+        q = header[1];
+        n = header[2];
+        pheno = header[3] != 0;
+        uint32_t float32_ = 0;
+        if (header[0] >= 2 && !in.read(&float32_, sizeof(uint32_t), 1)) {
+            stop("\nNot a trajectory file: " + file);
+        }
+        float32 = float32_ != 0;
+        data_start = tell64(in.fp);
+        row_bytes = 0;
+        for (uint32_t c = 0; c < 4 + 2 * q; c++) {
+            row_bytes += col_bytes(c, float32);
+        }
+    }
+
+    // Where column `c` starts within a chunk with `nr` rows:
+    inline uint64_t chunk_col_offset(const uint32_t& c,
+                                     const uint32_t& nr) const {
+        uint64_t off = 0;
+        for (uint32_t i = 0; i < c; i++) off += nr * col_bytes(i, float32);
+        return off;
+    }
+};
+
+
+/*
+ Read-only view of an indexed trajectory file.
+ The file is memory-mapped where possible, so only pages that are read
+ from are loaded.
+ On Windows, bytes are read using `fread` instead.
+
+ The mapping is `MAP_PRIVATE`, so it isn't a copy: if another process
+ truncates the file, reading pages past its new end raises SIGBUS, and if
+ it's rewritten in place, values change underneath us.
+ `unchanged` checks the file's size and modification time against those
+ when it was mapped, and lazy columns call it before reading.
+ That can't catch a change between the check and the read (or one within
+ the same second that keeps the size), so files being read lazily
+ shouldn't be modified.
+ */
+class IndexedFile {
+public:
+
+    uint32_t q;
+    uint32_t n;
+    bool pheno;
+    bool float32;
+    uint32_t n_reps;
+    uint64_t n_rows;
+    std::vector<uint64_t> offsets;  // byte offset of each column
+    std::vector<uint64_t> starts;   // first row for each rep
+    std::vector<uint64_t> counts;   // # rows for each rep
+
+    IndexedFile(const std::string& file)
+        : q(0), n(0), pheno(false), float32(false), n_reps(0), n_rows(0),
+          offsets(), starts(), counts(),
+          data(NULL), size(0), mtime(0), in(file) {
+
+        char magic[8];
+        uint32_t header[6];
+        read_bytes(magic, 0, 8);
+        if (std::memcmp(magic, TRAJ_INDEX_MAGIC, 8) != 0) {
+            stop("\nNot an indexed trajectory file: " + file);
+        }
+        read_bytes(header, 8, sizeof(header));
+        if (header[0] == 0 || header[0] > TRAJ_INDEX_VERSION) {
+            stop("\nUnknown indexed trajectory file version: " +
+                std::to_string(header[0]));
+        }
+        q = header[1];
+        n = header[2];
+        pheno = header[3] != 0;
+        n_reps = header[4];
+        float32 = header[5] != 0;   // always 0 in version 1
+        uint64_t pos = 8 + sizeof(header);
+        read_bytes(&n_rows, pos, sizeof(uint64_t));
+        pos += sizeof(uint64_t);
+        offsets.resize(4 + 2 * q);
+        read_bytes(offsets.data(), pos, offsets.size() * sizeof(uint64_t));
+        pos += offsets.size() * sizeof(uint64_t);
+        std::vector<uint64_t> index(2 * n_reps);
+        read_bytes(index.data(), pos, index.size() * sizeof(uint64_t));
+        starts.resize(n_reps);
+        counts.resize(n_reps);
+        for (uint32_t i = 0; i < n_reps; i++) {
+            starts[i] = index[2*i];
+            counts[i] = index[2*i+1];
+        }
+
+        // (Mapping last so nothing above can leave it un-mapped)
+#ifndef _WIN32
+        struct stat st;
+        if (fstat(fileno(in.fp), &st) == 0 && st.st_size > 0) {
+            size = static_cast<uint64_t>(st.st_size);
+            mtime = st.st_mtime;
+            void* ptr = mmap(NULL, size, PROT_READ, MAP_PRIVATE,
+                             fileno(in.fp), 0);
+            if (ptr != MAP_FAILED) data = static_cast<const char*>(ptr);
+        }
+#endif
+
+    }
+    ~IndexedFile() {
+#ifndef _WIN32
+        if (data != NULL) munmap(const_cast<char*>(data), size);
+#endif
+    }
+    IndexedFile(const IndexedFile&) = delete;
+    IndexedFile& operator=(const IndexedFile&) = delete;
+
+    /*
+     Whether the file is mapped and big enough for all columns.
+     If so, `value` never needs to read from the file or stop.
+     */
+    bool mapped() const {
+        if (data == NULL) return false;
+        for (uint32_t c = 0; c < offsets.size(); c++) {
+            if (offsets[c] + n_rows * traj_io::col_bytes(c, float32) > size) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether the file has the same size and modification time as when mapped:
+    bool unchanged() const {
+#ifndef _WIN32
+        if (data == NULL) return true;
+        struct stat st;
+        if (fstat(fileno(in.fp), &st) != 0) return false;
+        return static_cast<uint64_t>(st.st_size) == size && st.st_mtime == mtime;
+#else
+        return true;
+#endif
+    }
+
+    // Value in row `row` of column `c`:
+    inline double value(const uint32_t& c, const uint64_t& row) {
+        char x[sizeof(double)];
+        const uint64_t size_ = traj_io::col_bytes(c, float32);
+        read_bytes(x, offsets[c] + row * size_, size_);
+        return traj_io::col_value(x, 0, c, float32);
+    }
+
+    // Read raw rows `[row0, row0 + n_)` of column `c`:
+    void read_column(std::vector<char>& out, const uint32_t& c,
+                     const uint64_t& row0, const uint64_t& n_) {
+        const uint64_t size_ = traj_io::col_bytes(c, float32);
+        out.resize(n_ * size_);
+        read_bytes(out.data(), offsets[c] + row0 * size_, n_ * size_);
+        return;
+    }
+
+    /*
+     First row in `[row0, row1)` where time is >= `t` (or > `t` if `after`
+     is true), using the fact that times are sorted within reps.
+     */
+    uint64_t time_bound(uint64_t row0, uint64_t row1, const double& t,
+                        const bool& after) {
+        uint32_t t_;
+        while (row0 < row1) {
+            const uint64_t mid = row0 + (row1 - row0) / 2;
+            read_bytes(&t_, offsets[1] + mid * sizeof(uint32_t),
+                       sizeof(uint32_t));
+            if (t_ < t || (after && t_ == t)) {
+                row0 = mid + 1;
+            } else row1 = mid;
+        }
+        return row0;
+    }
+
+private:
+
+    const char* data;   // mapped file (NULL if not mapped)
+    uint64_t size;
+    time_t mtime;
+    File in;
+
+    void read_bytes(void* out, const uint64_t& offset, const uint64_t& bytes) {
+        if (bytes == 0) return;
+        if (data != NULL) {
+            if (offset + bytes > size) stop("\nTruncated trajectory file");
+            std::memcpy(out, data + offset, bytes);
+        } else {
+            if (seek64(in.fp, static_cast<int64_t>(offset), SEEK_SET) != 0 ||
+                !in.read(out, 1, bytes)) {
+                stop("\nTruncated trajectory file");
+            }
+        }
+        return;
+    }
+
+};
+
+
+
+/*
+ Rows of an indexed file for reps in `reps` (all reps if empty),
+ times in `[t_min, t_max]`, and species in `spp` (all species if empty).
+ For each rep with rows in that time range, `row0s` gets its first row
+ in the range, `reps_kept` gets the rep, and `keep` gets the rows
+ (relative to the first one) with the right species.
+ Returns the total number of rows kept.
+ */
+inline uint64_t select_rows(IndexedFile& idx,
+                            std::vector<uint32_t> reps,
+                            const double& t_min,
+                            const double& t_max,
+                            const std::vector<uint32_t>& spp,
+                            std::vector<uint64_t>& row0s,
+                            std::vector<uint32_t>& reps_kept,
+                            std::vector<std::vector<uint64_t>>& keep) {
+
+    if (reps.empty()) {
+        reps.resize(idx.n_reps);
+        for (uint32_t i = 0; i < idx.n_reps; i++) reps[i] = i + 1;
+    }
+    std::vector<bool> keep_spp(idx.n + 1, spp.empty());
+    for (const uint32_t& s : spp) {
+        if (s <= idx.n) keep_spp[s] = true;
+    }
+
+    row0s.clear();
+    reps_kept.clear();
+    keep.clear();
+    std::vector<char> raw;
+    uint64_t total_rows = 0;
+    for (const uint32_t& r : reps) {
+        if (r == 0 || r > idx.n_reps) continue;
+        const uint64_t s = idx.starts[r-1];
+        const uint64_t e = s + idx.counts[r-1];
+        const uint64_t row0 = idx.time_bound(s, e, t_min, false);
+        const uint64_t row1 = idx.time_bound(row0, e, t_max, true);
+        if (row1 <= row0) continue;
+        row0s.push_back(row0);
+        reps_kept.push_back(r);
+        keep.push_back(std::vector<uint64_t>());
+        idx.read_column(raw, 2, row0, row1 - row0);
+        for (uint64_t k = 0; k < (row1 - row0); k++) {
+            const uint32_t s_ = col_value(raw.data(), k, 2, false);
+            if (s_ <= idx.n && keep_spp[s_]) keep.back().push_back(k);
+        }
+        total_rows += keep.back().size();
+    }
+
+    return total_rows;
+}
+
+
+
+#ifdef SAURON_TRAJ_ALTREP
+
+/*
+ Lazy, long-format view of some rows in an indexed file.
+
+ Rows are stored as runs of consecutive rows in the file, so a view of
+ whole reps or time ranges is only a few numbers per rep.
+ All columns in one view share it (and its mapping of the file), and the
+ file is un-mapped when the last of them is garbage collected.
+ */
+class TrajView {
+public:
+
+    std::unique_ptr<IndexedFile> file;
+    std::vector<uint64_t> run_row0;     // first row in the file for each run
+    std::vector<uint64_t> run_start;    // first view row for each run, then total
+
+    TrajView(std::unique_ptr<IndexedFile>&& file_)
+        : file(std::move(file_)), run_row0(), run_start(1, 0) {}
+
+    // Add row `row` in the file to the end of the view:
+    void add_row(const uint64_t& row) {
+        const uint64_t n_runs = run_row0.size();
+        if (n_runs > 0 &&
+            run_row0.back() + (run_start[n_runs] - run_start[n_runs-1]) == row) {
+            run_start.back()++;
+        } else {
+            run_row0.push_back(row);
+            run_start.push_back(run_start.back() + 1);
+        }
+        return;
+    }
+
+    inline uint64_t n_rows() const { return run_start.back(); }
+
+    // Run that view row `i` is in:
+    inline uint64_t find_run(const uint64_t& i) const {
+        return std::upper_bound(run_start.begin(), run_start.end(), i) -
+            run_start.begin() - 1;
+    }
+
+};
+
+
+enum TrajColumnType {traj_id, traj_spp, traj_axis, traj_value};
+
+/*
+ One long-format column of a view (one row per wide row and axis).
+ ID columns and `N` are column `col` in the file for every axis, and
+ genotypes or phenotypes are column `col + axis`.
+ */
+class TrajColumn : public lazy_col::LazyColumn {
+public:
+
+    std::shared_ptr<TrajView> view;
+    uint32_t col;
+    TrajColumnType type;
+
+    TrajColumn(const std::shared_ptr<TrajView>& view_,
+               const uint32_t& col_,
+               const TrajColumnType& type_)
+        : view(view_), col(col_), type(type_) {}
+
+    R_xlen_t length() const {
+        return static_cast<R_xlen_t>(view->n_rows() * view->file->q);
+    }
+    void fill(R_xlen_t i, const R_xlen_t& n_, int* out) const {
+        fill_<int>(i, n_, out);
+    }
+    void fill(R_xlen_t i, const R_xlen_t& n_, double* out) const {
+        fill_<double>(i, n_, out);
+    }
+
+    // Error if the file changed since it was mapped:
+    void check() const {
+        if (!view->file->unchanged()) {
+            Rf_error("trajectory file has changed since it was read lazily; "
+                     "use `read_traj` to read it again");
+        }
+        return;
+    }
+
+    std::string describe() const {
+        return "trajectory file column " + std::to_string(col);
+    }
+
+private:
+
+    // Fill `out` with values for long-format rows `[i, i + n_)`:
+    template <typename T>
+    void fill_(uint64_t i, const uint64_t& n_, T* out) const {
+        const TrajView& v(*view);
+        const uint32_t& q(v.file->q);
+        if (n_ == 0) return;
+        uint64_t r = v.find_run(i / q);
+        for (uint64_t j = 0; j < n_; j++, i++) {
+            const uint64_t vrow = i / q;
+            while (vrow >= v.run_start[r+1]) r++;
+            get(v.run_row0[r] + (vrow - v.run_start[r]), i % q, out[j]);
+        }
+        return;
+    }
+
+    inline void get(const uint64_t& row, const uint32_t& axis, int& x) const {
+        if (type == traj_axis) {
+            x = axis + 1;
+            return;
+        }
+        const double v = view->file->value(col, row);
+        if (type == traj_spp && (v < 1 || v > view->file->n)) {
+            x = NA_INTEGER;
+        } else x = static_cast<int>(v);
+        return;
+    }
+    inline void get(const uint64_t& row, const uint32_t& axis,
+                    double& x) const {
+        if (col == 3) {
+            x = view->file->value(col, row);
+            return;
+        }
+        x = view->file->value(col + axis, row);
+        if (std::isnan(x)) x = NA_REAL;
+        return;
+    }
+
+};
+
+
+
+// Make a lazy column:
+SEXP new_traj_column(const std::shared_ptr<TrajView>& view,
+                     const uint32_t& col,
+                     const TrajColumnType& type) {
+    return lazy_col::new_lazy_column(new TrajColumn(view, col, type),
+                                     type != traj_value);
+}
+
+#endif
+
+}
+
+
+
+//' Read a trajectory file.
+//'
+//' Returns a list with `nv` (formatted the same as `quant_gen_cpp` output
+//' through time, but with rows in the order they were written),
+//' `q`, `n`, and `pheno`.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List read_traj_cpp(const std::string& file) {
+
+    traj_io::File in(file);
+    const traj_io::StreamHeader hdr(in, file);
+    const uint32_t& q(hdr.q);
+
+    /*
+     Go through once to find the total # rows using chunk sizes,
+     then go back through and fill in values.
+     */
+    uint64_t total_rows = 0;
+    uint32_t nr;
+    while (in.read(&nr, sizeof(uint32_t), 1)) {
+        total_rows += nr;
+        if (!in.skip(nr * hdr.row_bytes)) {
+            stop("\nTruncated trajectory file: " + file);
+        }
+    }
+    traj_io::seek64(in.fp, hdr.data_start, SEEK_SET);
+
+    arma::mat nv(total_rows, 4 + 2 * q);
+
+    std::vector<char> raw;
+    uint64_t j = 0;
+    while (in.read(&nr, sizeof(uint32_t), 1)) {
+        Rcpp::checkUserInterrupt();
+        for (uint32_t c = 0; c < nv.n_cols; c++) {
+            raw.resize(nr * traj_io::col_bytes(c, hdr.float32));
+            if (!in.read(raw.data(), 1, raw.size())) {
+                stop("\nTruncated trajectory file: " + file);
+            }
+            for (uint32_t k = 0; k < nr; k++) {
+                nv(j+k, c) = traj_io::col_value(raw.data(), k, c, hdr.float32);
+            }
+        }
+        j += nr;
+    }
+
+    List out = List::create(_["nv"] = nv, _["q"] = q, _["n"] = hdr.n,
+                            _["pheno"] = hdr.pheno);
+
+    return out;
+
+}
+
+
+
+//' Make an indexed trajectory file from a streamed one.
+//'
+//' Rows are sorted by rep, and times stay in the order they were written
+//' (which is increasing within reps).
+//' The input is read twice (once to count rows, once to copy them), and
+//' only one chunk of it is kept in memory at a time.
+//' Returns the number of rows written.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+double index_traj_cpp(const std::string& in_file,
+                      const std::string& out_file) {
+
+    traj_io::File in(in_file);
+    const traj_io::StreamHeader hdr(in, in_file);
+    const uint32_t& q(hdr.q);
+    const uint32_t n_cols = 4 + 2 * q;
+
+    // Go through once to count rows for each rep:
+    std::vector<uint64_t> counts;
+    std::vector<uint32_t> reps;
+    uint32_t nr;
+    while (in.read(&nr, sizeof(uint32_t), 1)) {
+        reps.resize(nr);
+        if (!in.read(reps.data(), sizeof(uint32_t), nr) ||
+            !in.skip(nr * hdr.row_bytes - nr * sizeof(uint32_t))) {
+            stop("\nTruncated trajectory file: " + in_file);
+        }
+        for (const uint32_t& r : reps) {
+            if (r == 0) stop("\nRep of zero in trajectory file: " + in_file);
+            if (r > counts.size()) counts.resize(r, 0);
+            counts[r-1]++;
+        }
+    }
+    const uint32_t n_reps = counts.size();
+    std::vector<uint64_t> starts(n_reps, 0);
+    uint64_t n_rows = 0;
+    for (uint32_t i = 0; i < n_reps; i++) {
+        starts[i] = n_rows;
+        n_rows += counts[i];
+    }
+
+    // Header, then columns each starting at a multiple of 8 bytes:
+    const uint32_t header[6] = {TRAJ_INDEX_VERSION, q, hdr.n,
+                                static_cast<uint32_t>(hdr.pheno), n_reps,
+                                static_cast<uint32_t>(hdr.float32)};
+    uint64_t pos = 8 + sizeof(header) + sizeof(uint64_t) +
+        n_cols * sizeof(uint64_t) + 2 * n_reps * sizeof(uint64_t);
+    std::vector<uint64_t> offsets(n_cols);
+    for (uint32_t c = 0; c < n_cols; c++) {
+        offsets[c] = pos;
+        pos += n_rows * traj_io::col_bytes(c, hdr.float32);
+        pos += (8 - pos % 8) % 8;
+    }
+    std::vector<uint64_t> index(2 * n_reps);
+    for (uint32_t i = 0; i < n_reps; i++) {
+        index[2*i] = starts[i];
+        index[2*i+1] = counts[i];
+    }
+
+    traj_io::File out(out_file, "wb");
+    bool ok = out.write(TRAJ_INDEX_MAGIC, 1, 8) &&
+        out.write(header, sizeof(uint32_t), 6) &&
+        out.write(&n_rows, sizeof(uint64_t), 1) &&
+        out.write(offsets.data(), sizeof(uint64_t), n_cols) &&
+        out.write(index.data(), sizeof(uint64_t), 2 * n_reps);
+
+    // Padding after each column (which also sets the file's size):
+    const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    std::vector<uint64_t> sizes(n_cols);
+    for (uint32_t c = 0; c < n_cols && ok; c++) {
+        sizes[c] = traj_io::col_bytes(c, hdr.float32);
+        const uint64_t col_end = offsets[c] + n_rows * sizes[c];
+        const uint64_t end = (c + 1 < n_cols) ? offsets[c+1] : pos;
+        if (end > col_end) {
+            ok = traj_io::seek64(out.fp, col_end, SEEK_SET) == 0 &&
+                out.write(zeros, 1, end - col_end);
+        }
+    }
+
+    /*
+     Then go back through once, reading one whole chunk at a time and
+     writing each run of rows from the same rep where it goes in every
+     column.
+     Threads write rows from one rep at a time to their buffers, so runs
+     are usually long, and there are few writes per column and chunk.
+     Columns are copied as raw bytes, so types don't change.
+     */
+    std::vector<char> chunk;
+    std::vector<uint64_t> chunk_offsets(n_cols);
+    std::vector<uint64_t> cursor(starts);
+    traj_io::seek64(in.fp, hdr.data_start, SEEK_SET);
+    while (ok && in.read(&nr, sizeof(uint32_t), 1)) {
+        Rcpp::checkUserInterrupt();
+        chunk.resize(nr * hdr.row_bytes);
+        if (!in.read(chunk.data(), 1, chunk.size())) {
+            stop("\nTruncated trajectory file: " + in_file);
+        }
+        reps.resize(nr);
+        if (nr > 0) std::memcpy(reps.data(), chunk.data(), nr * sizeof(uint32_t));
+        for (uint32_t c = 0; c < n_cols; c++) {
+            chunk_offsets[c] = hdr.chunk_col_offset(c, nr);
+        }
+        uint32_t k0 = 0;
+        while (k0 < nr && ok) {
+            const uint32_t r = reps[k0];
+            if (r == 0 || r > n_reps) {
+                stop("\nTrajectory file changed while indexing: " + in_file);
+            }
+            // (Rows for this rep are at `[k0, k1)` in this chunk)
+            uint32_t k1 = k0 + 1;
+            while (k1 < nr && reps[k1] == r) k1++;
+            const uint64_t row = cursor[r-1];
+            if (row + (k1 - k0) > starts[r-1] + counts[r-1]) {
+                stop("\nTrajectory file changed while indexing: " + in_file);
+            }
+            for (uint32_t c = 0; c < n_cols && ok; c++) {
+                ok = traj_io::seek64(out.fp, offsets[c] + sizes[c] * row,
+                                     SEEK_SET) == 0 &&
+                    out.write(chunk.data() + chunk_offsets[c] + sizes[c] * k0,
+                              1, sizes[c] * (k1 - k0));
+            }
+            cursor[r-1] += k1 - k0;
+            k0 = k1;
+        }
+    }
+
+    if (std::fclose(out.fp) != 0) ok = false;
+    out.fp = NULL;
+    if (!ok) stop("\nError writing to file: " + out_file);
+
+    return static_cast<double>(n_rows);
+
+}
+
+
+
+//' Read slices of an indexed trajectory file.
+//'
+//' Only rows for reps in `reps` (all reps if empty), times in
+//' `[t_min, t_max]`, and species in `spp` (all species if empty) are read.
+//' Returns a list formatted the same as `read_traj_cpp` output.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+List read_traj_index_cpp(const std::string& file,
+                         const std::vector<uint32_t>& reps,
+                         const double& t_min,
+                         const double& t_max,
+                         const std::vector<uint32_t>& spp) {
+
+    traj_io::IndexedFile idx(file);
+    const uint32_t n_cols = 4 + 2 * idx.q;
+
+    std::vector<uint64_t> row0s;
+    std::vector<uint32_t> reps_kept;
+    std::vector<std::vector<uint64_t>> keep;
+    const uint64_t total_rows = traj_io::select_rows(idx, reps, t_min, t_max,
+                                                     spp, row0s, reps_kept,
+                                                     keep);
+    std::vector<char> raw;
+
+    arma::mat nv(total_rows, n_cols);
+
+    uint64_t j = 0;
+    for (uint32_t i = 0; i < row0s.size(); i++) {
+        Rcpp::checkUserInterrupt();
+        if (keep[i].empty()) continue;
+        const uint64_t nr = keep[i].back() + 1;
+        for (uint32_t c = 0; c < n_cols; c++) {
+            idx.read_column(raw, c, row0s[i], nr);
+            for (uint64_t k = 0; k < keep[i].size(); k++) {
+                nv(j+k, c) = traj_io::col_value(raw.data(), keep[i][k], c,
+                                                idx.float32);
+            }
+        }
+        j += keep[i].size();
+    }
+
+    List out = List::create(_["nv"] = nv, _["q"] = idx.q, _["n"] = idx.n,
+                            _["pheno"] = idx.pheno);
+
+    return out;
+
+}
+
+
+
+//' Lazily read slices of an indexed trajectory file.
+//'
+//' Rows are chosen the same way as for `read_traj_index_cpp`, but this
+//' returns the long-format tibble itself (formatted the same as `nv` in
+//' `quant_gen` output through time), and its columns are ALTREP vectors
+//' that read from the memory-mapped file as values are used.
+//' Nothing is copied into R unless something asks for a pointer to a
+//' column's data, and then only that column is copied.
+//' `reps` should be sorted and unique so that rows are sorted.
+//'
+//' Returns `NULL` when this isn't possible (R < 3.6.0, Windows, a file that
+//' can't be mapped, or no rows), and `read_traj_index_cpp` should be used
+//' instead.
+//'
+//' @noRd
+//'
+//[[Rcpp::export]]
+SEXP read_traj_lazy_cpp(const std::string& file,
+                        const std::vector<uint32_t>& reps,
+                        const double& t_min,
+                        const double& t_max,
+                        const std::vector<uint32_t>& spp) {
+
+#ifdef SAURON_TRAJ_ALTREP
+
+    std::unique_ptr<traj_io::IndexedFile> idx(new traj_io::IndexedFile(file));
+    if (!idx->mapped()) return R_NilValue;
+
+    std::vector<uint64_t> row0s;
+    std::vector<uint32_t> reps_kept;
+    std::vector<std::vector<uint64_t>> keep;
+    const uint64_t total_rows = traj_io::select_rows(*idx, reps, t_min, t_max,
+                                                     spp, row0s, reps_kept,
+                                                     keep);
+    if (total_rows == 0) return R_NilValue;
+
+    const uint32_t q = idx->q;
+    // Row names (and so # rows) of data frames have to fit in an int:
+    if (total_rows * q > static_cast<uint64_t>(INT_MAX)) {
+        stop("\nToo many rows (" + std::to_string(total_rows * q) +
+            ") for one data frame; read fewer reps or times at once");
+    }
+    const uint32_t n = idx->n;
+    const bool pheno = idx->pheno;
+
+    std::shared_ptr<traj_io::TrajView> view =
+        std::make_shared<traj_io::TrajView>(std::move(idx));
+    uint32_t max_rep = 0;
+    for (uint32_t i = 0; i < row0s.size(); i++) {
+        for (const uint64_t& k : keep[i]) view->add_row(row0s[i] + k);
+        if (!keep[i].empty() && reps_kept[i] > max_rep) max_rep = reps_kept[i];
+    }
+
+    const uint32_t n_cols = pheno ? 8 : 7;
+    List out(n_cols);
+    CharacterVector names(n_cols);
+
+    // Add column `j` that's a factor if `n_lvls > 0`:
+    auto add_col = [&](const uint32_t& j, const std::string& name,
+                       const uint32_t& col,
+                       const traj_io::TrajColumnType& type,
+                       const int& n_lvls) {
+        SEXP x = PROTECT(traj_io::new_traj_column(view, col, type));
+        if (n_lvls > 0) {
+            CharacterVector levels(n_lvls);
+            for (int i = 0; i < n_lvls; i++) levels[i] = std::to_string(i + 1);
+            Rf_setAttrib(x, R_LevelsSymbol, levels);
+            Rf_setAttrib(x, R_ClassSymbol, CharacterVector::create("factor"));
+        }
+        out[j] = x;
+        names[j] = name;
+        UNPROTECT(1);
+        return;
+    };
+
+    add_col(0, "rep", 0, traj_io::traj_id, max_rep);
+    add_col(1, "time", 1, traj_io::traj_id, 0);
+    add_col(2, "spp", 2, traj_io::traj_spp, n);
+    add_col(3, "axis", 0, traj_io::traj_axis, q);
+    add_col(4, "N", 3, traj_io::traj_value, 0);
+    add_col(5, "geno", 4, traj_io::traj_value, 0);
+    if (pheno) add_col(6, "pheno", 4 + q, traj_io::traj_value, 0);
+
+    out.attr("names") = names;
+    // (Compact form of row names; checked above that this fits)
+    out.attr("row.names") = IntegerVector::create(
+        NA_INTEGER, -static_cast<int>(total_rows * q));
+    out.attr("class") = CharacterVector::create("tbl_df", "tbl",
+                                                "data.frame");
+
+    return out;
+
+#else
+
+    return R_NilValue;
+
+#endif
+
+}
@@ -0,0 +1,229 @@
+#ifndef __SAURON_TRAJ_IO_H
+#define __SAURON_TRAJ_IO_H
+
+
+#include <RcppArmadillo.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace Rcpp;
+
+
+
+/*
+ Streaming trajectories to a binary, chunked columnar file.
+
+ The file starts with a header:
+   magic        8 bytes, "SAURONQG"
+   version      uint32
+   q            uint32, # traits
+   n            uint32, # species
+   pheno        uint32, whether phenotypes differ from genotypes
+   float32      uint32, whether traits are stored as floats (version >= 2)
+ Followed by any number of chunks, each of which has:
+   n_rows       uint32
+   rep          uint32 x n_rows
+   time         uint32 x n_rows
+   spp          uint32 x n_rows
+   N            double x n_rows
+   geno_k       double (or float) x n_rows   (for k in 1:q)
+   pheno_k      double (or float) x n_rows   (for k in 1:q)
+ All numbers use the machine's native byte order.
+ Rows from different reps can be in any order among chunks.
+ Version 1 files have no `float32` field and always store doubles.
+ */
+
+#define TRAJ_MAGIC "SAURONQG"
+#define TRAJ_VERSION 2U
+
+/*
+ Indexed trajectory files (made from the above by `index_traj_cpp`) have all
+ rows sorted by rep then time, so slices can be read without reading
+ everything else.
+ The header is:
+   magic        8 bytes, "SAURONQI"
+   version      uint32
+   q            uint32
+   n            uint32
+   pheno        uint32
+   n_reps       uint32
+   float32      uint32 (padding that's always 0 in version 1)
+   n_rows       uint64
+   offsets      uint64 x (4 + 2q), byte offset of each column
+   index        uint64 x (2 n_reps), first row and # rows for each rep
+ Followed by full columns in the same order and types as above,
+ each starting at a multiple of 8 bytes.
+ */
+#define TRAJ_INDEX_MAGIC "SAURONQI"
+#define TRAJ_INDEX_VERSION 2U
+
+// Rows in each thread's buffer before it's written to the file:
+#define TRAJ_BUFFER_ROWS 16384U
+
+
+class TrajBuffer;
+
+
+/*
+ One output file, shared among threads.
+ Writing is done inside a critical section, so only whole chunks from
+ one thread are written at a time.
+ */
+class TrajFile {
+public:
+
+    const uint32_t q;
+    const bool float32;
+    bool failed;
+    uint64_t n_rows;    // rows written so far
+
+    TrajFile(const std::string& path,
+             const uint32_t& q_,
+             const uint32_t& n_,
+             const bool& pheno_,
+             const bool& float32_ = false)
+        : q(q_), float32(float32_), failed(false), n_rows(0),
+          fp(std::fopen(path.c_str(), "wb")) {
+        if (fp == NULL) stop("\nCan't open file for writing: " + path);
+        const uint32_t header[5] = {TRAJ_VERSION, q_, n_,
+                                    static_cast<uint32_t>(pheno_),
+                                    static_cast<uint32_t>(float32_)};
+        write_raw(TRAJ_MAGIC, 1, 8);
+        write_raw(header, sizeof(uint32_t), 5);
+    }
+    ~TrajFile() {
+        if (fp != NULL) std::fclose(fp);
+    }
+    TrajFile(const TrajFile&) = delete;
+    TrajFile& operator=(const TrajFile&) = delete;
+
+    // Close the file, and return whether everything was written:
+    bool close() {
+        if (fp != NULL && std::fclose(fp) != 0) failed = true;
+        fp = NULL;
+        return !failed;
+    }
+
+    void write_chunk(const TrajBuffer& buf);
+
+private:
+
+    std::FILE* fp;
+    std::vector<float> floats;  // for traits if `float32` is true
+
+    inline void write_raw(const void* x, const size_t& size,
+                          const size_t& count) {
+        if (count == 0 || failed) return;
+        if (std::fwrite(x, size, count, fp) != count) failed = true;
+        return;
+    }
+    inline void write_trait(const std::vector<double>& x) {
+        if (!float32) {
+            write_raw(x.data(), sizeof(double), x.size());
+            return;
+        }
+        floats.assign(x.begin(), x.end());
+        write_raw(floats.data(), sizeof(float), floats.size());
+        return;
+    }
+
+};
+
+
+
+/*
+ Bounded buffer of rows for one thread.
+ When it's full, its rows are written to the file as one chunk.
+ */
+class TrajBuffer {
+public:
+
+    std::vector<uint32_t> rep;
+    std::vector<uint32_t> time;
+    std::vector<uint32_t> spp;
+    std::vector<double> N;
+    std::vector<std::vector<double>> geno;
+    std::vector<std::vector<double>> pheno;
+
+    TrajBuffer(TrajFile& file_)
+        : rep(), time(), spp(), N(), geno(file_.q), pheno(file_.q),
+          file(file_) {
+        rep.reserve(TRAJ_BUFFER_ROWS);
+        time.reserve(TRAJ_BUFFER_ROWS);
+        spp.reserve(TRAJ_BUFFER_ROWS);
+        N.reserve(TRAJ_BUFFER_ROWS);
+        for (uint32_t k = 0; k < file.q; k++) {
+            geno[k].reserve(TRAJ_BUFFER_ROWS);
+            pheno[k].reserve(TRAJ_BUFFER_ROWS);
+        }
+    }
+    ~TrajBuffer() {
+        flush();
+    }
+    TrajBuffer(const TrajBuffer&) = delete;
+    TrajBuffer& operator=(const TrajBuffer&) = delete;
+
+    inline uint32_t n_rows() const { return rep.size(); }
+
+    inline void add(const uint32_t& rep_,
+                    const uint32_t& time_,
+                    const uint32_t& spp_,
+                    const double& N_,
+                    const arma::vec& geno_,
+                    const arma::vec& pheno_) {
+        rep.push_back(rep_);
+        time.push_back(time_);
+        spp.push_back(spp_);
+        N.push_back(N_);
+        for (uint32_t k = 0; k < file.q; k++) {
+            geno[k].push_back(geno_(k));
+            pheno[k].push_back(pheno_(k));
+        }
+        if (n_rows() >= TRAJ_BUFFER_ROWS) flush();
+        return;
+    }
+
+    void flush() {
+        if (n_rows() == 0) return;
+        file.write_chunk(*this);
+        rep.clear();
+        time.clear();
+        spp.clear();
+        N.clear();
+        for (uint32_t k = 0; k < file.q; k++) {
+            geno[k].clear();
+            pheno[k].clear();
+        }
+        return;
+    }
+
+private:
+
+    TrajFile& file;
+
+};
+
+
+
+inline void TrajFile::write_chunk(const TrajBuffer& buf) {
+    const uint32_t nr = buf.n_rows();
+    #ifdef _OPENMP
+    #pragma omp critical(traj_write)
+    #endif
+    {
+    write_raw(&nr, sizeof(uint32_t), 1);
+    write_raw(buf.rep.data(), sizeof(uint32_t), nr);
+    write_raw(buf.time.data(), sizeof(uint32_t), nr);
+    write_raw(buf.spp.data(), sizeof(uint32_t), nr);
+    write_raw(buf.N.data(), sizeof(double), nr);
+    for (uint32_t k = 0; k < q; k++) write_trait(buf.geno[k]);
+    for (uint32_t k = 0; k < q; k++) write_trait(buf.pheno[k]);
+    n_rows += nr;
+    }
+    return;
+}
+
+
+
+#endif